@@ -8,5 +8,8 @@
 
 #include "common/math.h"
 #include "common/util.h"
+#include "common/arena.h"
 #include "common/bin.h"
-#include "common/stream.h"
\ No newline at end of file
+#include "common/stream.h"
+#include "common/strbuf.h"
+#include "common/thread.h"
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include "../common.h"
+
+void arena_init(arena_t* arena, size_t size)
+{
+	arena->size = ARENA_SIZE(size);
+	arena->base = arena->size ? malloc(arena->size) : NULL;
+	arena->used = 0;
+}
+
+void arena_free(arena_t* arena)
+{
+	free(arena->base);
+	arena->base = NULL;
+	arena->size = 0;
+	arena->used = 0;
+}
+
+void* arena_alloc(arena_t* arena, size_t size)
+{
+	size = ARENA_SIZE(size);
+	if (!arena->base || arena->size - arena->used < size)
+	{
+		printf("Arena out of memory (%zu/%zu bytes, wanted %zu)\n", arena->used, arena->size, size);
+		return NULL;
+	}
+
+	void* ptr = arena->base + arena->used;
+	arena->used += size;
+	return ptr;
+}
+
+size_t arena_mark(arena_t* arena)
+{
+	return arena->used;
+}
+
+void arena_rewind(arena_t* arena, size_t mark)
+{
+	if (mark < arena->used)
+		arena->used = mark;
+}
+
+void arena_reset(arena_t* arena)
+{
+	arena->used = 0;
+}
+
+#if defined( HANACHAN_DEBUG_ALLOC )
+
+#undef malloc
+#undef calloc
+#undef realloc
+
+static THREAD_LOCAL uint64_t debug_alloc_counter = 0;
+
+void* debug_malloc(size_t size)
+{
+	debug_alloc_counter++;
+	return malloc(size);
+}
+
+void* debug_calloc(size_t count, size_t size)
+{
+	debug_alloc_counter++;
+	return calloc(count, size);
+}
+
+void* debug_realloc(void* ptr, size_t size)
+{
+	debug_alloc_counter++;
+	return realloc(ptr, size);
+}
+
+uint64_t debug_alloc_count(void)
+{
+	return debug_alloc_counter;
+}
+
+#endif
@@ -0,0 +1,35 @@
+#pragma once
+
+/* bump allocator, everything is released at once with arena_reset or arena_free */
+typedef struct arena_t
+{
+	uint8_t*	base;
+	size_t		size;
+	size_t		used;
+} arena_t;
+
+enum { arena_align = 16 };
+
+void		arena_init(arena_t* arena, size_t size);
+void		arena_free(arena_t* arena);
+void*		arena_alloc(arena_t* arena, size_t size);
+size_t		arena_mark(arena_t* arena);
+void		arena_rewind(arena_t* arena, size_t mark);
+void		arena_reset(arena_t* arena);
+
+#define ARENA_SIZE(size) (((size) + arena_align - 1) & ~(size_t)(arena_align - 1))
+
+/* 
+	debug builds can count every heap allocation made on the current thread,
+	used to check that stepping a game never touches the allocator
+*/
+#if defined( HANACHAN_DEBUG_ALLOC )
+void*		debug_malloc(size_t size);
+void*		debug_calloc(size_t count, size_t size);
+void*		debug_realloc(void* ptr, size_t size);
+uint64_t	debug_alloc_count(void);
+
+#define malloc(size)			debug_malloc(size)
+#define calloc(count, size)		debug_calloc(count, size)
+#define realloc(ptr, size)		debug_realloc(ptr, size)
+#endif
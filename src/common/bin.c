@@ -1,5 +1,18 @@
+#if !defined( _WIN32 )
+#define _POSIX_C_SOURCE 200112L /* posix_madvise */
+#endif
+
 #include "../common.h"
 
+#if defined( _WIN32 )
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 void bin_init(bin_t* bin)
 {
 	bin->buffer = NULL;
@@ -39,4 +52,118 @@ void bin_copy(bin_t* to, bin_t* from)
 	to->buffer = malloc(from->size);
 	to->size = from->size;
 	memcpy(to->buffer, from->buffer, from->size);
-}
\ No newline at end of file
+}
+
+#if defined( _WIN32 )
+
+int bin_map(bin_t* bin, const char* filename)
+{
+	bin_init(bin);
+
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return 0;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return 0;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (!mapping)
+		return 0;
+
+	/* the view keeps the mapping alive */
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (!view)
+		return 0;
+
+	bin_set(bin, view, (size_t)size.QuadPart);
+	return 1;
+}
+
+/* size and last write time, enough to tell a file changed since it was looked at */
+int bin_stat(const char* filename, uint64_t* size, uint64_t* mtime)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExA(filename, GetFileExInfoStandard, &attributes))
+		return 0;
+
+	*size = (uint64_t)attributes.nFileSizeHigh << 32 | attributes.nFileSizeLow;
+	*mtime = (uint64_t)attributes.ftLastWriteTime.dwHighDateTime << 32 | attributes.ftLastWriteTime.dwLowDateTime;
+	return 1;
+}
+
+void bin_unmap(bin_t* bin)
+{
+	if (bin->buffer)
+		UnmapViewOfFile(bin->buffer);
+	bin_init(bin);
+}
+
+/* starts reading a range of a mapping in the background, only a hint */
+void bin_prefetch(bin_t* bin, size_t offset, size_t size)
+{
+	WIN32_MEMORY_RANGE_ENTRY range = { bin->buffer + offset, size };
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+#else
+
+int bin_map(bin_t* bin, const char* filename)
+{
+	bin_init(bin);
+
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return 0;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		close(fd);
+		return 0;
+	}
+
+	void* view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (view == MAP_FAILED)
+		return 0;
+
+	bin_set(bin, view, (size_t)st.st_size);
+	return 1;
+}
+
+/* size and last write time, enough to tell a file changed since it was looked at */
+int bin_stat(const char* filename, uint64_t* size, uint64_t* mtime)
+{
+	struct stat st;
+	if (stat(filename, &st) != 0)
+		return 0;
+
+	*size = (uint64_t)st.st_size;
+	*mtime = (uint64_t)st.st_mtime;
+	return 1;
+}
+
+void bin_unmap(bin_t* bin)
+{
+	if (bin->buffer)
+		munmap(bin->buffer, bin->size);
+	bin_init(bin);
+}
+
+/* starts reading a range of a mapping in the background, only a hint */
+void bin_prefetch(bin_t* bin, size_t offset, size_t size)
+{
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	size_t start = offset - offset % page;
+	posix_madvise(bin->buffer + start, size + offset - start, POSIX_MADV_WILLNEED);
+}
+
+#endif
\ No newline at end of file
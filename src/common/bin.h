@@ -16,12 +16,23 @@ void        bin_free(bin_t* bin);
 void        bin_set (bin_t* bin, uint8_t* buffer, size_t size);
 int         bin_read(bin_t* bin, const char* filename);
 void        bin_copy(bin_t* to, bin_t* from);
+int         bin_stat(const char* filename, uint64_t* size, uint64_t* mtime);
+
+/* read-only file mapping, pages are shared with other processes mapping the same file */
+int         bin_map  (bin_t* bin, const char* filename);
+void        bin_unmap(bin_t* bin);
+void        bin_prefetch(bin_t* bin, size_t offset, size_t size);
+
+/* each parser's functions take its own object type and are cast to these */
+typedef void	(*parser_init_t )(void* obj);
+typedef void	(*parser_free_t )(void* obj);
+typedef int		(*parser_parse_t)(void* obj, bin_t* bin);
 
 typedef struct
 {
-	void	(*init )(void* obj);
-	void	(*free )(void* obj);
-	int		(*parse)(void* obj, bin_t* bin);
+	parser_init_t	init;
+	parser_free_t	free;
+	parser_parse_t	parse;
 } parser_t;
 
 typedef struct
@@ -51,4 +62,26 @@ inline int parser_read(parser_t* parser, void* obj, const char* filename)
 
 	bin_free(&buffer);
 	return ret;
-}
\ No newline at end of file
+}
+
+/* like parser_read, but the file is mapped instead of read into a copy */
+inline int parser_map(parser_t* parser, void* obj, const char* filename)
+{
+	bin_t buffer;
+	int ret = 0;
+
+	if (!bin_map(&buffer, filename))
+	{
+		printf("Couldn't open %s\n", filename);
+		return ret;
+	}
+
+	parser->init(obj);
+	if (parser->parse(obj, &buffer))
+		ret = 1;
+	else
+		printf("Couldn't parse %s\n", filename);
+
+	bin_unmap(&buffer);
+	return ret;
+}
@@ -5,6 +5,9 @@
 
 #ifndef M_PI
 	#define M_PI   3.14159265358979323846264338327950288
+#endif
+
+#ifndef M_PI_F
 	#define M_PI_F 3.14159265358979323846264338327950288f
 #endif
 
@@ -0,0 +1,84 @@
+#include "../common.h"
+#include <stdarg.h>
+
+void strbuf_init(strbuf_t* buf)
+{
+	buf->buffer = NULL;
+	buf->size = 0;
+	buf->capacity = 0;
+}
+
+void strbuf_free(strbuf_t* buf)
+{
+	free(buf->buffer);
+	buf->buffer = NULL;
+	buf->size = 0;
+	buf->capacity = 0;
+}
+
+void strbuf_clear(strbuf_t* buf)
+{
+	buf->size = 0;
+	if (buf->buffer)
+		buf->buffer[0] = '\0';
+}
+
+/* NULL buffer prints straight to stdout */
+void strbuf_printf(strbuf_t* buf, const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+
+	if (!buf)
+	{
+		vprintf(format, args);
+		va_end(args);
+		return;
+	}
+
+	va_list args_copy;
+	va_copy(args_copy, args);
+	int len = vsnprintf(NULL, 0, format, args_copy);
+	va_end(args_copy);
+
+	if (len > 0)
+	{
+		size_t required = buf->size + (size_t)len + 1;
+		if (required > buf->capacity)
+		{
+			size_t capacity = buf->capacity ? buf->capacity : 256;
+			while (capacity < required)
+				capacity *= 2;
+			buf->buffer = realloc(buf->buffer, capacity);
+			buf->capacity = capacity;
+		}
+
+		vsnprintf(buf->buffer + buf->size, buf->capacity - buf->size, format, args);
+		buf->size += (size_t)len;
+	}
+
+	va_end(args);
+}
+
+/* quoted, with quotes, backslashes and control characters escaped */
+void strbuf_json_string(strbuf_t* buf, const char* str)
+{
+	strbuf_printf(buf, "\"");
+	for (; *str; str++)
+	{
+		if (*str == '"' || *str == '\\')
+			strbuf_printf(buf, "\\%c", *str);
+		else if ((unsigned char)*str < 0x20)
+			strbuf_printf(buf, "\\u%04x", *str);
+		else
+			strbuf_printf(buf, "%c", *str);
+	}
+	strbuf_printf(buf, "\"");
+}
+
+void strbuf_flush(strbuf_t* buf, FILE* file)
+{
+	if (buf->size > 0)
+		fwrite(buf->buffer, 1, buf->size, file);
+	strbuf_clear(buf);
+}
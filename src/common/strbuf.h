@@ -0,0 +1,15 @@
+#pragma once
+
+typedef struct strbuf_t
+{
+	char*		buffer;
+	size_t		size;
+	size_t		capacity;
+} strbuf_t;
+
+void		strbuf_init(strbuf_t* buf);
+void		strbuf_free(strbuf_t* buf);
+void		strbuf_clear(strbuf_t* buf);
+void		strbuf_printf(strbuf_t* buf, const char* format, ...);
+void		strbuf_json_string(strbuf_t* buf, const char* str);
+void		strbuf_flush(strbuf_t* buf, FILE* file);
@@ -0,0 +1,219 @@
+#include "../common.h"
+
+#if defined( _WIN32 )
+#include <windows.h>
+#include <process.h>
+
+struct thread_t
+{
+	HANDLE			handle;
+	thread_func_t	func;
+	void*			userdata;
+	int				ret;
+};
+
+struct mutex_t
+{
+	CRITICAL_SECTION section;
+};
+
+struct cond_t
+{
+	CONDITION_VARIABLE variable;
+};
+
+unsigned __stdcall thread_entry(void* param)
+{
+	thread_t* thread = param;
+	thread->ret = thread->func(thread->userdata);
+	return 0;
+}
+
+thread_t* thread_create(thread_func_t func, void* userdata)
+{
+	thread_t* thread = malloc(sizeof(thread_t));
+	thread->func = func;
+	thread->userdata = userdata;
+	thread->ret = 0;
+	thread->handle = (HANDLE)_beginthreadex(NULL, 0, thread_entry, thread, 0, NULL);
+	if (!thread->handle)
+	{
+		free(thread);
+		return NULL;
+	}
+
+	return thread;
+}
+
+int thread_join(thread_t* thread)
+{
+	WaitForSingleObject(thread->handle, INFINITE);
+	CloseHandle(thread->handle);
+	int ret = thread->ret;
+	free(thread);
+	return ret;
+}
+
+int thread_cpu_count(void)
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (int)info.dwNumberOfProcessors;
+}
+
+mutex_t* mutex_create(void)
+{
+	mutex_t* mutex = malloc(sizeof(mutex_t));
+	InitializeCriticalSection(&mutex->section);
+	return mutex;
+}
+
+void mutex_free(mutex_t* mutex)
+{
+	if (!mutex)
+		return;
+	DeleteCriticalSection(&mutex->section);
+	free(mutex);
+}
+
+void mutex_lock(mutex_t* mutex)
+{
+	EnterCriticalSection(&mutex->section);
+}
+
+void mutex_unlock(mutex_t* mutex)
+{
+	LeaveCriticalSection(&mutex->section);
+}
+
+cond_t* cond_create(void)
+{
+	cond_t* cond = malloc(sizeof(cond_t));
+	InitializeConditionVariable(&cond->variable);
+	return cond;
+}
+
+void cond_free(cond_t* cond)
+{
+	free(cond);
+}
+
+void cond_wait(cond_t* cond, mutex_t* mutex)
+{
+	SleepConditionVariableCS(&cond->variable, &mutex->section, INFINITE);
+}
+
+void cond_broadcast(cond_t* cond)
+{
+	WakeAllConditionVariable(&cond->variable);
+}
+
+#else
+#include <pthread.h>
+#include <unistd.h>
+
+struct thread_t
+{
+	pthread_t		handle;
+	thread_func_t	func;
+	void*			userdata;
+	int				ret;
+};
+
+struct mutex_t
+{
+	pthread_mutex_t	handle;
+};
+
+struct cond_t
+{
+	pthread_cond_t	handle;
+};
+
+void* thread_entry(void* param)
+{
+	thread_t* thread = param;
+	thread->ret = thread->func(thread->userdata);
+	return NULL;
+}
+
+thread_t* thread_create(thread_func_t func, void* userdata)
+{
+	thread_t* thread = malloc(sizeof(thread_t));
+	thread->func = func;
+	thread->userdata = userdata;
+	thread->ret = 0;
+	if (pthread_create(&thread->handle, NULL, thread_entry, thread) != 0)
+	{
+		free(thread);
+		return NULL;
+	}
+
+	return thread;
+}
+
+int thread_join(thread_t* thread)
+{
+	pthread_join(thread->handle, NULL);
+	int ret = thread->ret;
+	free(thread);
+	return ret;
+}
+
+int thread_cpu_count(void)
+{
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (int)count : 1;
+}
+
+mutex_t* mutex_create(void)
+{
+	mutex_t* mutex = malloc(sizeof(mutex_t));
+	pthread_mutex_init(&mutex->handle, NULL);
+	return mutex;
+}
+
+void mutex_free(mutex_t* mutex)
+{
+	if (!mutex)
+		return;
+	pthread_mutex_destroy(&mutex->handle);
+	free(mutex);
+}
+
+void mutex_lock(mutex_t* mutex)
+{
+	pthread_mutex_lock(&mutex->handle);
+}
+
+void mutex_unlock(mutex_t* mutex)
+{
+	pthread_mutex_unlock(&mutex->handle);
+}
+
+cond_t* cond_create(void)
+{
+	cond_t* cond = malloc(sizeof(cond_t));
+	pthread_cond_init(&cond->handle, NULL);
+	return cond;
+}
+
+void cond_free(cond_t* cond)
+{
+	if (!cond)
+		return;
+	pthread_cond_destroy(&cond->handle);
+	free(cond);
+}
+
+void cond_wait(cond_t* cond, mutex_t* mutex)
+{
+	pthread_cond_wait(&cond->handle, &mutex->handle);
+}
+
+void cond_broadcast(cond_t* cond)
+{
+	pthread_cond_broadcast(&cond->handle);
+}
+
+#endif
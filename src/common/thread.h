@@ -0,0 +1,21 @@
+#pragma once
+
+typedef struct thread_t thread_t;
+typedef struct mutex_t  mutex_t;
+typedef struct cond_t   cond_t;
+
+typedef int (*thread_func_t)(void* userdata);
+
+thread_t*	thread_create(thread_func_t func, void* userdata);
+int			thread_join(thread_t* thread);
+int			thread_cpu_count(void);
+
+mutex_t*	mutex_create(void);
+void		mutex_free(mutex_t* mutex);
+void		mutex_lock(mutex_t* mutex);
+void		mutex_unlock(mutex_t* mutex);
+
+cond_t*		cond_create(void);
+void		cond_free(cond_t* cond);
+void		cond_wait(cond_t* cond, mutex_t* mutex);
+void		cond_broadcast(cond_t* cond);
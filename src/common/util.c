@@ -0,0 +1,18 @@
+#include "../common.h"
+
+/* C99 inline needs one external definition per function outside MSVC */
+#if !defined( _MSC_VER )
+extern inline uint32_t	ssub_uint32(uint32_t a, uint32_t b);
+extern inline int16_t	bswap_int16(int16_t val);
+extern inline uint16_t	bswap_uint16(uint16_t val);
+extern inline int32_t	bswap_int32(int32_t val);
+extern inline uint32_t	bswap_uint32(uint32_t val);
+extern inline float		bswap_float(float val);
+extern inline vec2_t	bswap_vec2(vec2_t* val);
+extern inline vec3_t	bswap_vec3(vec3_t* val);
+extern inline quat_t	bswap_quat(quat_t* val);
+extern inline char*		strcat2(char* dest, char* src);
+extern inline char*		strext(char* dest, const char* src, const char* ext);
+extern inline int		parser_read(parser_t* parser, void* obj, const char* filename);
+extern inline int		parser_map(parser_t* parser, void* obj, const char* filename);
+#endif
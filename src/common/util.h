@@ -9,6 +9,30 @@
 #define UNREACHABLE() (__assume(0))
 #endif
 
+#if defined( _MSC_VER )
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
+
+/* MSVC provides these, fill them in when building elsewhere */
+#if !defined( _WIN32 )
+#include <strings.h>
+#define stricmp strcasecmp
+#endif
+
+#ifndef _MAX_PATH
+#define _MAX_PATH 260
+#endif
+
+#ifndef min
+#define min(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+
+#ifndef max
+#define max(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+
 #define XZ(v) v.x, v.y
 #define XYZ(v) v.x, v.y, v.z
 #define XYZW(v) v.x, v.y, v.z, v.w
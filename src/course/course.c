@@ -1,9 +1,8 @@
 #include "../common.h"
 #include "course.h"
-#include "../fs/yaz.h"
 #include "../fs/arc.h"
 
-const char* course_ids[] =
+const char* course_ids[course_max_id] =
 {
 	"castle_course",
 	"farm_course",
@@ -43,32 +42,33 @@ void course_init(course_t* course)
 {
 	kmp_parser.init(&course->kmp);
 	kcl_parser.init(&course->kcl);
+	bin_init(&course->map);
 }
 
 void course_free(course_t* course)
 {
+	if (course->map.buffer)
+	{
+		/* nothing to free, it all lives in the mapping */
+		bin_t map = course->map;
+		course_init(course);
+		bin_unmap(&map);
+		return;
+	}
+
 	kmp_parser.free(&course->kmp);
 	kcl_parser.free(&course->kcl);
 }
 
 int course_parse(course_t* course, bin_t* course_buffer)
 {
-	bin_t input;
 	arc_t arc;
 	int ret = 0;
 
-	if (yaz_decompress(course_buffer, &input) != YAZ_OK)
-	{
-		printf("Error decompressing input data\n");
-		return ret;
-	}
-
+	/* decompressed once, straight into the archive the KMP and KCL are read from */
 	arc_parser.init(&arc);
-	if (!arc_parser.parse(&arc, &input))
-	{
-		bin_free(&input);
+	if (!arc_parser.parse(&arc, course_buffer))
 		goto cleanup;
-	}
 
 	const char* kmp_filename = "course.kmp";
 	bin_t* kmp_buffer = arc_find_data(&arc, kmp_filename);
@@ -102,21 +102,20 @@ cleanup:
 	if (ret != 1)
 		course_free(course);
 	arc_parser.free(&arc);
-	bin_free(&input);
 
 	return ret;
 }
 
 const char* course_name_by_id(uint8_t id)
 {
-	if (id > ARRAY_LEN(course_ids))
+	if (id >= ARRAY_LEN(course_ids))
 		return "";
 	return course_ids[id];
 }
 
 parser_t course_parser =
 {
-	course_init,
-	course_free,
-	course_parse
+	(parser_init_t)course_init,
+	(parser_free_t)course_free,
+	(parser_parse_t)course_parse
 };
\ No newline at end of file
@@ -3,10 +3,16 @@
 #include "../fs/kmp.h"
 #include "../fs/kcl.h"
 
+enum
+{
+	course_max_id = 32,
+};
+
 typedef struct course_t
 {
 	kmp_t	kmp;
 	kcl_t	kcl;
+	bin_t	map;	/* set when kmp and kcl point into a mapped course_bin file */
 } course_t;
 
 extern parser_t course_parser;
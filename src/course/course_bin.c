@@ -0,0 +1,219 @@
+#include "../common.h"
+#include "course_bin.h"
+
+static const char course_bin_id[4] = { 'H', 'C', 'B', 'N' };
+
+typedef struct
+{
+	const void*	data;
+	uint32_t	count;
+	uint32_t	stride;
+} course_bin_source_t;
+
+void course_bin_sources(course_t* course, course_bin_source_t* sources)
+{
+	kcl_t* kcl = &course->kcl;
+	kcl_octree_t* octree = &kcl->octree;
+	kmp_section_header_t* ktpt_header = &course->kmp.section_headers[kmp_section_ktpt];
+
+	sources[course_bin_section_tris]		= (course_bin_source_t){ kcl->tris, kcl->tri_count, sizeof(*kcl->tris) };
+	sources[course_bin_section_vertices]	= (course_bin_source_t){ kcl->vertices, kcl->vertex_count * 3, sizeof(*kcl->vertices) };
+	sources[course_bin_section_root_nodes]	= (course_bin_source_t){ octree->root_nodes, octree->root_node_count, sizeof(*octree->root_nodes) };
+	sources[course_bin_section_branches]	= (course_bin_source_t){ octree->branches, octree->branch_count, sizeof(*octree->branches) };
+	sources[course_bin_section_tri_lists]	= (course_bin_source_t){ octree->tri_lists, octree->tri_list_count, sizeof(*octree->tri_lists) };
+	sources[course_bin_section_tri_index]	= (course_bin_source_t){ octree->tri_index, octree->tri_index_count, sizeof(*octree->tri_index) };
+	sources[course_bin_section_tri_groups]	= (course_bin_source_t){ kcl->tri_groups, kcl->tri_group_count, sizeof(*kcl->tri_groups) };
+	sources[course_bin_section_ktpt]		= (course_bin_source_t){ course->kmp.ktpt, course->kmp.ktpt ? ktpt_header->entry_count : 0, sizeof(*course->kmp.ktpt) };
+}
+
+int course_bin_write(course_t* course, const char* filename, const char* source_path)
+{
+	uint64_t source_size, source_mtime;
+	if (!bin_stat(source_path, &source_size, &source_mtime))
+	{
+		printf("Couldn't open %s\n", source_path);
+		return 0;
+	}
+
+	/* write beside the target and swap it in, so readers never map a partial file */
+	char temp_filename[_MAX_PATH];
+	snprintf(temp_filename, sizeof(temp_filename), "%s.tmp", filename);
+
+	FILE* file = fopen(temp_filename, "wb");
+	if (!file)
+	{
+		printf("Failed to open %s for writing\n", temp_filename);
+		return 0;
+	}
+
+	course_bin_source_t sources[course_bin_section_max];
+	course_bin_sources(course, sources);
+
+	course_bin_header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.id.cc, course_bin_id, sizeof(course_bin_id));
+	header.version = course_bin_version;
+	header.kcl_header = course->kcl.header;
+	header.source_size = source_size;
+	header.source_mtime = source_mtime;
+
+	static const uint8_t padding[16] = { 0 };
+	uint32_t offset = sizeof(header);
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+	for (int i = 0; i < course_bin_section_max && ok; i++)
+	{
+		course_bin_source_t* source = &sources[i];
+		course_bin_section_t* section = &header.sections[i];
+
+		uint32_t pad = (16 - offset % 16) % 16;
+		ok = pad == 0 || fwrite(padding, 1, pad, file) == pad;
+		offset += pad;
+
+		section->offset = offset;
+		section->count  = source->count;
+		section->stride = source->stride;
+
+		uint32_t size = source->count * source->stride;
+		if (size > 0)
+			ok = ok && fwrite(source->data, 1, size, file) == size;
+		offset += size;
+	}
+
+	header.file_size = offset;
+	ok = ok && fseek(file, 0, SEEK_SET) == 0
+		&& fwrite(&header, sizeof(header), 1, file) == 1;
+	ok = (fclose(file) == 0) && ok;
+
+	if (!ok)
+	{
+		printf("Failed to write %s\n", temp_filename);
+		remove(temp_filename);
+		return 0;
+	}
+
+	remove(filename);
+	if (rename(temp_filename, filename) != 0)
+	{
+		printf("Failed to move %s to %s\n", temp_filename, filename);
+		remove(temp_filename);
+		return 0;
+	}
+
+	return 1;
+}
+
+int course_bin_map(course_t* course, const char* filename, const char* source_path)
+{
+	bin_t map;
+	if (!bin_map(&map, filename))
+		return 0;
+
+	uint64_t source_size, source_mtime;
+	bool have_source = bin_stat(source_path, &source_size, &source_mtime);
+
+	course_bin_header_t* header = (course_bin_header_t*)map.buffer;
+	if (map.size < sizeof(*header)
+		|| memcmp(header->id.cc, course_bin_id, sizeof(course_bin_id))
+		|| header->version != course_bin_version
+		|| header->file_size != map.size)
+	{
+		printf("Ignoring %s, bad header or built by another version\n", filename);
+		bin_unmap(&map);
+		return 0;
+	}
+
+	/* a course without its .szs beside it is still fine to use */
+	if (have_source && (header->source_size != source_size || header->source_mtime != source_mtime))
+	{
+		printf("Ignoring %s, %s changed since it was built\n", filename, source_path);
+		bin_unmap(&map);
+		return 0;
+	}
+
+	/* strides catch a file written with a different struct layout */
+	course_bin_source_t sources[course_bin_section_max];
+	course_bin_sources(course, sources);
+
+	for (int i = 0; i < course_bin_section_max; i++)
+	{
+		course_bin_section_t* section = &header->sections[i];
+		if (section->stride != sources[i].stride
+			|| section->offset % 16
+			|| section->offset > map.size
+			|| (uint64_t)section->count * section->stride > map.size - section->offset)
+		{
+			printf("Ignoring %s, bad section %d\n", filename, i);
+			bin_unmap(&map);
+			return 0;
+		}
+	}
+
+	void* data[course_bin_section_max];
+	for (int i = 0; i < course_bin_section_max; i++)
+		data[i] = header->sections[i].count ? map.buffer + header->sections[i].offset : NULL;
+
+	kcl_t* kcl = &course->kcl;
+	kcl->header				  = header->kcl_header;
+	kcl->tris				  = data[course_bin_section_tris];
+	kcl->tri_count			  = header->sections[course_bin_section_tris].count;
+	kcl->vertices			  = data[course_bin_section_vertices];
+	kcl->vertex_count		  = header->sections[course_bin_section_vertices].count / 3;
+
+	kcl_octree_t* octree = &kcl->octree;
+	octree->root_nodes		  = data[course_bin_section_root_nodes];
+	octree->root_node_count	  = header->sections[course_bin_section_root_nodes].count;
+	octree->branches		  = data[course_bin_section_branches];
+	octree->branch_count	  = header->sections[course_bin_section_branches].count;
+	octree->tri_lists		  = data[course_bin_section_tri_lists];
+	octree->tri_list_count	  = header->sections[course_bin_section_tri_lists].count;
+	octree->tri_index		  = data[course_bin_section_tri_index];
+	octree->tri_index_count	  = header->sections[course_bin_section_tri_index].count;
+	kcl->tri_groups			  = data[course_bin_section_tri_groups];
+	kcl->tri_group_count	  = header->sections[course_bin_section_tri_groups].count;
+
+	kmp_section_header_t* ktpt_header = &course->kmp.section_headers[kmp_section_ktpt];
+	memcpy(ktpt_header->id.cc, "KTPT", 4);
+	ktpt_header->entry_count  = (uint16_t)header->sections[course_bin_section_ktpt].count;
+	course->kmp.ktpt		  = data[course_bin_section_ktpt];
+
+	/* sizes alone don't stop a damaged file from indexing past its sections */
+	if (header->sections[course_bin_section_ktpt].count > UINT16_MAX
+		|| header->sections[course_bin_section_vertices].count % 3
+		|| !kcl_octree_check(kcl))
+	{
+		printf("Ignoring %s, bad octree or sections\n", filename);
+		bin_unmap(&map);
+		return 0;
+	}
+
+	course->map = map;
+	return 1;
+}
+
+int course_bin_build(const char* course_dir, uint8_t course_id)
+{
+	const char* course_name = course_name_by_id(course_id);
+	if (!course_name[0])
+		return 0;
+
+	char course_path[_MAX_PATH];
+	snprintf(course_path, sizeof(course_path), "%s/%s.szs", course_dir, course_name);
+
+	/* course folders usually only hold some of the tracks */
+	FILE* file = fopen(course_path, "rb");
+	if (!file)
+		return 0;
+	fclose(file);
+
+	course_t course;
+	if (!parser_map(&course_parser, &course, course_path))
+		return 0;
+
+	char bin_path[_MAX_PATH];
+	snprintf(bin_path, sizeof(bin_path), "%s/%s.hcb", course_dir, course_name);
+
+	int ret = course_bin_write(&course, bin_path, course_path);
+	course_parser.free(&course);
+	return ret;
+}
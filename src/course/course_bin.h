@@ -0,0 +1,50 @@
+#pragma once
+
+#include "course.h"
+
+/*
+* Precompiled course, the parsed KCL and KMP start points written out in native
+* layout so a course can be mapped read-only and used without any parsing.
+* Sections are addressed by offset from the start of the file. The size and write
+* time of the .szs it was built from are kept, a changed course is parsed again
+*/
+enum
+{
+	course_bin_version = 4,
+};
+
+enum
+{
+	course_bin_section_tris,
+	course_bin_section_vertices,
+	course_bin_section_root_nodes,
+	course_bin_section_branches,
+	course_bin_section_tri_lists,
+	course_bin_section_tri_index,
+	course_bin_section_tri_groups,
+	course_bin_section_ktpt,
+
+	course_bin_section_max
+};
+
+typedef struct
+{
+	uint32_t	offset;
+	uint32_t	count;
+	uint32_t	stride;
+} course_bin_section_t;
+
+typedef struct
+{
+	id_t		id;
+	uint32_t	version;
+	uint32_t	file_size;
+	kcl_header_t kcl_header;
+	course_bin_section_t sections[course_bin_section_max];
+	uint64_t	source_size;
+	uint64_t	source_mtime;
+} course_bin_header_t;
+
+int course_bin_write(course_t* course, const char* filename, const char* source_path);
+int course_bin_map  (course_t* course, const char* filename, const char* source_path);
+int course_bin_build(const char* course_dir, uint8_t course_id);
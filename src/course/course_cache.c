@@ -0,0 +1,137 @@
+#include "../common.h"
+#include "course_cache.h"
+#include "course_bin.h"
+#include <stddef.h>
+
+void course_cache_init(course_cache_t* cache, int capacity)
+{
+	for (int i = 0; i < course_max_id; i++)
+	{
+		course_cache_entry_t* entry = &cache->entries[i];
+		course_parser.init(&entry->course);
+		entry->mutex = mutex_create();
+		entry->ref_count = 0;
+		entry->last_used = 0;
+		entry->loaded = false;
+	}
+
+	cache->capacity = capacity;
+	cache->loaded_count = 0;
+	cache->tick = 0;
+	cache->mutex = mutex_create();
+}
+
+void course_cache_free(course_cache_t* cache)
+{
+	for (int i = 0; i < course_max_id; i++)
+	{
+		course_cache_entry_t* entry = &cache->entries[i];
+		if (entry->loaded)
+			course_parser.free(&entry->course);
+		mutex_free(entry->mutex);
+		entry->mutex = NULL;
+		entry->ref_count = 0;
+		entry->loaded = false;
+	}
+
+	mutex_free(cache->mutex);
+	cache->mutex = NULL;
+	cache->loaded_count = 0;
+}
+
+/* must hold cache->mutex */
+void course_cache_trim(course_cache_t* cache)
+{
+	while (cache->capacity > 0 && cache->loaded_count > cache->capacity)
+	{
+		course_cache_entry_t* oldest = NULL;
+		for (int i = 0; i < course_max_id; i++)
+		{
+			course_cache_entry_t* entry = &cache->entries[i];
+			if (!entry->loaded || entry->ref_count > 0)
+				continue;
+			if (!oldest || entry->last_used < oldest->last_used)
+				oldest = entry;
+		}
+
+		/* everything left is in use */
+		if (!oldest)
+			break;
+
+		course_parser.free(&oldest->course);
+		oldest->loaded = false;
+		cache->loaded_count--;
+	}
+}
+
+course_t* course_cache_acquire(course_cache_t* cache, const char* course_dir, uint8_t course_id)
+{
+	const char* course_name = course_name_by_id(course_id);
+	if (!course_name[0])
+	{
+		printf("Failed to load course, invalid ID %u\n", course_id);
+		return NULL;
+	}
+
+	course_cache_entry_t* entry = &cache->entries[course_id];
+
+	mutex_lock(cache->mutex);
+	entry->ref_count++;
+	entry->last_used = ++cache->tick;
+	mutex_unlock(cache->mutex);
+
+	/* only the first user of a course pays for loading it, others wait on the entry */
+	mutex_lock(entry->mutex);
+
+	bool loaded = entry->loaded;
+	if (!loaded)
+	{
+		char course_path[_MAX_PATH];
+		char bin_path[_MAX_PATH];
+		sprintf(course_path, "%s/%s.szs", course_dir, course_name);
+		sprintf(bin_path, "%s/%s.hcb", course_dir, course_name);
+
+		/* prefer a course built with -build-cache, it maps without parsing */
+		loaded = course_bin_map(&entry->course, bin_path, course_path);
+		if (!loaded)
+			loaded = parser_map(&course_parser, &entry->course, course_path);
+
+		if (loaded)
+		{
+			mutex_lock(cache->mutex);
+			entry->loaded = true;
+			cache->loaded_count++;
+			course_cache_trim(cache);
+			mutex_unlock(cache->mutex);
+		}
+		else
+		{
+			printf("Failed to load course %s, parsing error\n", course_name);
+		}
+	}
+
+	mutex_unlock(entry->mutex);
+
+	if (!loaded)
+	{
+		mutex_lock(cache->mutex);
+		entry->ref_count--;
+		mutex_unlock(cache->mutex);
+		return NULL;
+	}
+
+	return &entry->course;
+}
+
+void course_cache_release(course_cache_t* cache, course_t* course)
+{
+	if (!course)
+		return;
+
+	course_cache_entry_t* entry = (course_cache_entry_t*)((uint8_t*)course - offsetof(course_cache_entry_t, course));
+
+	mutex_lock(cache->mutex);
+	entry->ref_count--;
+	course_cache_trim(cache);
+	mutex_unlock(cache->mutex);
+}
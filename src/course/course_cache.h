@@ -0,0 +1,31 @@
+#pragma once
+
+#include "course.h"
+
+typedef struct
+{
+	course_t		course;
+	mutex_t*		mutex;
+	int				ref_count;
+	uint64_t		last_used;
+	bool			loaded;
+} course_cache_entry_t;
+
+/*
+* Parsed courses shared between games, keyed by course ID
+* Courses stay loaded while referenced, unreferenced courses are evicted
+* least recently used first once more than capacity are loaded
+*/
+typedef struct course_cache_t
+{
+	course_cache_entry_t entries[course_max_id];
+	int				capacity;
+	int				loaded_count;
+	uint64_t		tick;
+	mutex_t*		mutex;
+} course_cache_t;
+
+void		course_cache_init(course_cache_t* cache, int capacity);
+void		course_cache_free(course_cache_t* cache);
+course_t*	course_cache_acquire(course_cache_t* cache, const char* course_dir, uint8_t course_id);
+void		course_cache_release(course_cache_t* cache, course_t* course);
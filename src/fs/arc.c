@@ -8,35 +8,165 @@ void arc_init(arc_t* arc)
 	arc->string_pool = NULL;
 	arc->data = NULL;
 	bin_init(&arc->bin);
+	arc->mapped = false;
+	arc->path_pool = NULL;
+	arc->path_index = NULL;
+	arc->name_index = NULL;
+	arc->index_mask = 0;
 }
 
 void arc_free(arc_t* arc)
 {
 	free(arc->nodes);
-	bin_free(&arc->bin);
+	free(arc->path_pool);
+	free(arc->path_index);
+	if (arc->mapped)
+		bin_unmap(&arc->bin);
+	else
+		bin_free(&arc->bin);
+	arc->mapped = false;
 	arc->nodes = NULL;
 	arc->string_pool = NULL;
 	arc->data = NULL;
+	arc->path_pool = NULL;
+	arc->path_index = NULL;
+	arc->name_index = NULL;
+	arc->index_mask = 0;
 }
 
-int arc_parse(arc_t* arc, bin_t* arc_buffer)
+uint32_t arc_hash(const char* string)
 {
-	int compressed = yaz_is_compressed(arc_buffer);
-	if (compressed)
+	uint32_t hash = 0x811C9DC5;
+	while (*string)
+		hash = (hash ^ (uint8_t)*string++) * 0x01000193;
+	return hash;
+}
+
+/* index + 1 of the file stored under key, or 0 */
+uint32_t arc_index_find(arc_t* arc, uint32_t* table, const char* key, bool by_path)
+{
+	for (uint32_t slot = arc_hash(key) & arc->index_mask; table[slot]; slot = (slot + 1) & arc->index_mask)
 	{
-		bin_init(&arc->bin);
-		if (yaz_decompress(arc_buffer, &arc->bin) != YAZ_OK)
+		arc_node_t* node = &arc->nodes[table[slot] - 1];
+		if (!strcmp(by_path ? node->path : node->filename, key))
+			return table[slot];
+	}
+	return 0;
+}
+
+/* a name already there keeps its first file, like the old front to back search did */
+void arc_index_insert(arc_t* arc, uint32_t* table, const char* key, bool by_path, uint32_t index)
+{
+	uint32_t slot = arc_hash(key) & arc->index_mask;
+	for (; table[slot]; slot = (slot + 1) & arc->index_mask)
+	{
+		arc_node_t* node = &arc->nodes[table[slot] - 1];
+		if (!strcmp(by_path ? node->path : node->filename, key))
+			return;
+	}
+	table[slot] = index + 1;
+}
+
+/*
+	gives every node its full path and hashes the files. a directory holds the
+	nodes up to its last_index, so the stack of open directories is popped once
+	the walk gets there. the root and "." add nothing to the path
+*/
+int arc_build_paths(arc_t* arc)
+{
+	int ret = 0;
+	uint32_t count = max(arc->node_count, 1);
+	uint32_t* parents = malloc(count * sizeof(uint32_t));
+	uint32_t* lengths = malloc(count * sizeof(uint32_t));
+	uint32_t* stack = malloc(count * sizeof(uint32_t));
+	uint32_t depth = 0;
+	size_t pool_size = 0;
+
+	for (uint32_t i = 0; i < arc->node_count; i++)
+	{
+		arc_node_t* node = &arc->nodes[i];
+		while (depth > 0 && i >= arc->nodes[stack[depth - 1]].last_index)
+			depth--;
+
+		if (i > 0 && depth == 0)
 		{
-			printf("Error reading U8, failed to decompress\n");
-			return 0;
+			printf("Error reading ARC, node %u is outside the root\n", i);
+			goto cleanup;
+		}
+
+		parents[i] = depth > 0 ? stack[depth - 1] : 0;
+		if (i < arc->start_index)
+			lengths[i] = 0;
+		else if (parents[i] < arc->start_index)
+			lengths[i] = (uint32_t)strlen(node->filename);
+		else
+			lengths[i] = lengths[parents[i]] + 1 + (uint32_t)strlen(node->filename);
+		pool_size += lengths[i] + 1;
+
+		if (node->type == arc_node_dir)
+		{
+			uint32_t end = depth > 0 ? arc->nodes[stack[depth - 1]].last_index : arc->node_count;
+			if (node->last_index <= i || node->last_index > end)
+			{
+				printf("Error reading ARC, bad directory at index %u\n", i);
+				goto cleanup;
+			}
+			stack[depth++] = i;
 		}
 	}
-	else
+
+	arc->path_pool = malloc(max(pool_size, 1));
+	char* path = arc->path_pool;
+	for (uint32_t i = 0; i < arc->node_count; i++)
 	{
-		bin_copy(&arc->bin, arc_buffer);
+		arc_node_t* node = &arc->nodes[i];
+		node->path = path;
+		*path = '\0';
+		if (i >= arc->start_index)
+		{
+			if (parents[i] >= arc->start_index)
+			{
+				path = strcat2(path, arc->nodes[parents[i]].path);
+				path = strcat2(path, "/");
+			}
+			path = strcat2(path, node->filename);
+		}
+		path++;
+	}
+
+	uint32_t size = 16;
+	while (size < count * 2)
+		size <<= 1;
+
+	arc->index_mask = size - 1;
+	arc->path_index = calloc((size_t)size * 2, sizeof(uint32_t));
+	arc->name_index = arc->path_index + size;
+	for (uint32_t i = arc->start_index; i < arc->node_count; i++)
+	{
+		if (arc->nodes[i].type != arc_node_file)
+			continue;
+
+		arc_index_insert(arc, arc->path_index, arc->nodes[i].path, true, i);
+		arc_index_insert(arc, arc->name_index, arc->nodes[i].filename, false, i);
 	}
 
+	ret = 1;
+
+cleanup:
+	free(stack);
+	free(lengths);
+	free(parents);
+	return ret;
+}
+
+int arc_parse_nodes(arc_t* arc)
+{
 	arc_header_t* header = &arc->header;
+	if (arc->bin.size < sizeof(arc_header_t))
+	{
+		printf("Error reading ARC, bad header\n");
+		return 0;
+	}
 
 	bswapstream_t stream;
 	bswapstream_init(&stream, arc->bin.buffer);
@@ -101,75 +231,129 @@ int arc_parse(arc_t* arc, bin_t* arc_buffer)
 	if (arc->node_count >= 2 && !strcmp(arc->nodes[1].filename, "."))
 		arc->start_index = 2;
 
-	return 1;
+	return arc_build_paths(arc);
 }
 
-void arc_find(arc_t* arc, arc_find_callback callback, void* userdata)
+/* the caller keeps arc_buffer, so an uncompressed archive is copied */
+int arc_parse(arc_t* arc, bin_t* arc_buffer)
 {
-	for (uint32_t i = arc->start_index; i < arc->node_count; i++)
+	int compressed = yaz_is_compressed(arc_buffer);
+	if (compressed)
 	{
-		arc_node_t* node = &arc->nodes[i];
-		if (!callback(node, userdata))
-			break;
+		if (yaz_decompress(arc_buffer, &arc->bin) != YAZ_OK)
+		{
+			printf("Error reading U8, failed to decompress\n");
+			return 0;
+		}
+	}
+	else
+	{
+		bin_copy(&arc->bin, arc_buffer);
 	}
+
+	return arc_parse_nodes(arc);
 }
 
-typedef struct
+/* maps the file, then decompresses it once or uses the mapping as is when it isn't compressed */
+int arc_open(arc_t* arc, const char* filename)
 {
-	const char* filename;
-	bin_t*		data;
-} arc_find_data_context_t;
+	arc_init(arc);
 
-int arc_find_data_callback(arc_node_t* node, void* userdata)
-{
-	if (node->type == arc_node_file)
+	bin_t file;
+	if (!bin_map(&file, filename))
 	{
-		arc_find_data_context_t* context = userdata;
-		if (!strcmp(node->filename, context->filename))
+		printf("Couldn't open %s\n", filename);
+		return 0;
+	}
+
+	if (yaz_is_compressed(&file))
+	{
+		int ret = yaz_decompress(&file, &arc->bin);
+		bin_unmap(&file);
+
+		if (ret != YAZ_OK)
 		{
-			context->data = &node->data;
+			printf("Error reading U8, failed to decompress %s\n", filename);
 			return 0;
 		}
 	}
+	else
+	{
+		arc->bin = file;
+		arc->mapped = true;
+	}
+
+	if (!arc_parse_nodes(arc))
+	{
+		printf("Couldn't parse %s\n", filename);
+		arc_free(arc);
+		return 0;
+	}
 
 	return 1;
 }
 
+void arc_find(arc_t* arc, arc_find_callback callback, void* userdata)
+{
+	for (uint32_t i = arc->start_index; i < arc->node_count; i++)
+	{
+		arc_node_t* node = &arc->nodes[i];
+		if (!callback(node, userdata))
+			break;
+	}
+}
+
+/*
+	"dir/file" looks up the full path, a leading "./" or "/" is ignored. a bare
+	filename falls back to the first file of that name in any directory
+*/
 bin_t* arc_find_data(arc_t* arc, const char* filename)
 {
-	arc_find_data_context_t context = { .filename = filename, .data = NULL };
-	arc_find(arc, arc_find_data_callback, &context);
-	return context.data;
+	if (!arc->path_index)
+		return NULL;
+
+	if (!strncmp(filename, "./", 2))
+		filename += 2;
+	else if (filename[0] == '/')
+		filename++;
+
+	uint32_t index = arc_index_find(arc, arc->path_index, filename, true);
+	if (!index && !strchr(filename, '/'))
+		index = arc_index_find(arc, arc->name_index, filename, false);
+
+	return index ? &arc->nodes[index - 1].data : NULL;
 }
 
-int arc_print_callback(arc_node_t* node, void* userdata)
+void arc_iter_init(arc_iter_t* iter, arc_t* arc)
 {
-	char* path = (char*)userdata;
-	if (node->type == arc_node_file)
-	{
-		printf("%08x %s%s\n", (uint32_t)node->data.size, path, node->filename);
-	}
-	else if (node->type == arc_node_dir)
+	iter->arc = arc;
+	iter->index = arc->start_index;
+}
+
+arc_node_t* arc_iter_next(arc_iter_t* iter)
+{
+	while (iter->index < iter->arc->node_count)
 	{
-		/* TODO: pop directories */
-		char* p = path;
-		p = strcat2(p, node->filename);
-		p = strcat2(p, "/");
+		arc_node_t* node = &iter->arc->nodes[iter->index++];
+		if (node->type == arc_node_file)
+			return node;
 	}
-
-	return 1;
+	return NULL;
 }
 
 void arc_print(arc_t* arc)
 {
-	char path[_MAX_PATH] = { 0 };
 	printf("Filesize Filename\n");
-	arc_find(arc, arc_print_callback, path);
+
+	arc_iter_t iter;
+	arc_iter_init(&iter, arc);
+	for (arc_node_t* node; (node = arc_iter_next(&iter)); )
+		printf("%08x %s\n", (uint32_t)node->data.size, node->path);
 }
 
 parser_t arc_parser =
 {
-	arc_init,
-	arc_free,
-	arc_parse,
+	(parser_init_t)arc_init,
+	(parser_free_t)arc_free,
+	(parser_parse_t)arc_parse,
 };
\ No newline at end of file
@@ -19,6 +19,7 @@ typedef struct
 {
 	uint8_t			type;
 	char*			filename;
+	char*			path;			/* "dir/file" below the root, built by arc_parse */
 	bin_t			data;
 	uint32_t		parent_index;
 	uint32_t		last_index;
@@ -33,13 +34,31 @@ typedef struct arc_t
 	uint32_t		node_count;
 	char*			string_pool;
 	uint8_t*		data;
-	bin_t			bin;
+	bin_t			bin;			/* nodes point into this, decompressed or the mapped file itself */
+	bool			mapped;
+
+	/* open addressing tables of node index + 1, by full path and by bare filename */
+	char*			path_pool;
+	uint32_t*		path_index;
+	uint32_t*		name_index;
+	uint32_t		index_mask;
 } arc_t;
 
+/* walks the files of an archive in order, node->path holds the full path */
+typedef struct
+{
+	arc_t*			arc;
+	uint32_t		index;
+} arc_iter_t;
+
 extern parser_t arc_parser;
 
+int		arc_open(arc_t* arc, const char* filename);
+
 typedef int (*arc_find_callback)(arc_node_t* node, void* userdata);
 
 void    arc_find (arc_t* arc, arc_find_callback callback, void* userdata);
 bin_t*	arc_find_data(arc_t* arc, const char* filename);
+void	arc_iter_init(arc_iter_t* iter, arc_t* arc);
+arc_node_t* arc_iter_next(arc_iter_t* iter);
 void	arc_print(arc_t* arc);
\ No newline at end of file
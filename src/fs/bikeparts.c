@@ -53,7 +53,7 @@ int bikeparts_parse(bikeparts_t* parts, bin_t* bin)
 
 parser_t bikeparts_parser =
 {
-	bikeparts_init,
-	bikeparts_free,
-	bikeparts_parse,
+	(parser_init_t)bikeparts_init,
+	(parser_free_t)bikeparts_free,
+	(parser_parse_t)bikeparts_parse,
 };
\ No newline at end of file
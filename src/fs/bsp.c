@@ -76,7 +76,7 @@ int bsp_parse(bsp_t* bsp, bin_t* bin)
 
 parser_t bsp_parser =
 {
-	bsp_init,
-	bsp_free,
-	bsp_parse,
+	(parser_init_t)bsp_init,
+	(parser_free_t)bsp_free,
+	(parser_parse_t)bsp_parse,
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "../common.h"
 #include "kcl.h"
 #include <float.h>
+#include <emmintrin.h>
 
 enum
 {
@@ -21,7 +22,7 @@ typedef struct
 
 typedef struct
 {
-	uint16_t* tris;
+	uint32_t  first;
 	uint32_t  tri_count;
 	uint32_t  offset;
 } kcl_raw_tri_list_t;
@@ -98,7 +99,14 @@ float variant_jump_pad_vel_y(uint8_t variant)
 
 void collision_init(collision_t* collision)
 {
-	memset(collision, 0, sizeof(*collision));
+	/* furthest slots are only read when set in furthest_kinds, skip clearing them */
+	collision->min			  = vec3_zero;
+	collision->max			  = vec3_zero;
+	collision->floor_dist	  = 0.0f;
+	collision->floor_normal	  = vec3_zero;
+	collision->furthest_kinds = 0;
+	collision->hit_count	  = 0;
+	collision->surface_kinds  = 0;
 }
 
 void collision_add_tri(collision_t* collision, collision_tri_t* tri)
@@ -119,9 +127,20 @@ void collision_add_tri(collision_t* collision, collision_tri_t* tri)
 
 	if (collision->hit_count < collision_max_hits)
 	{
-		hit_t* hit   = &collision->hits[collision->hit_count++];
-		hit->surface = tri->flags;
-		hit->dist    = tri->dist;
+		uint32_t kind = tri->flags & 0x1F;
+		hit_t* hit = &collision->furthest[kind];
+
+		/* same comparison a search from -FLT_MAX makes, so NaN never gets a slot */
+		bool has_hit = (collision->furthest_kinds & (1 << kind)) != 0;
+		if (has_hit ? tri->dist > hit->dist : tri->dist > -FLT_MAX)
+		{
+			hit->surface = tri->flags;
+			hit->dist    = tri->dist;
+			collision->furthest_order[kind] = (uint8_t)collision->hit_count;
+			collision->furthest_kinds |= 1 << kind;
+		}
+
+		collision->hit_count++;
 	}
 }
 
@@ -133,18 +152,21 @@ void collision_movement(collision_t* collision, vec3_t* out)
 hit_t* collision_find_furthest(collision_t* collision, uint32_t surface_kinds)
 {
 	hit_t* closest = NULL;
-	float closest_dist = -FLT_MAX;
+	int closest_order = 0;
 
-	for (int i = 0; i < collision->hit_count; i++)
+	uint32_t kinds = collision->furthest_kinds & surface_kinds;
+	for (int i = 0; kinds != 0; i++, kinds >>= 1)
 	{
-		hit_t* hit = &collision->hits[i];
-		if (((1 << (hit->surface & 0x1F)) & surface_kinds) == 0)
+		if ((kinds & 1) == 0)
 			continue;
 
-		if (hit->dist > closest_dist)
+		hit_t* hit = &collision->furthest[i];
+		int order = collision->furthest_order[i];
+		if (!closest || hit->dist > closest->dist
+			|| (hit->dist == closest->dist && order < closest_order))
 		{
 			closest = hit;
-			closest_dist = hit->dist;
+			closest_order = order;
 		}
 	}
 
@@ -159,6 +181,19 @@ void hitbox_init(hitbox_t* hitbox, vec3_t* pos, vec3_t* last_pos, float radius,
 	hitbox->radius = radius;
 	hitbox->flags = flags;
 	hitbox->last_pos_valid = last_pos != NULL;
+	hitbox_reset_leaf(hitbox);
+}
+
+void hitbox_reset_leaf(hitbox_t* hitbox)
+{
+	hitbox->leaf_kcl = NULL;
+	hitbox->leaf_idx = 0;
+	hitbox->leaf_x = 0;
+	hitbox->leaf_y = 0;
+	hitbox->leaf_z = 0;
+	hitbox->leaf_shift = 0;
+	hitbox->leaf_lookups = 0;
+	hitbox->leaf_hits = 0;
 }
 
 void hitbox_update_pos(hitbox_t* hitbox, vec3_t* pos)
@@ -316,30 +351,131 @@ bool kcl_tri_collision_hitbox(kcl_tri_t* tri, hitbox_t* hitbox, float thickness,
 	return true;
 }
 
-void kcl_octree_init(kcl_octree_t* octree)
+/* kcl_tri_dot for 4 lanes, with the same float and double rounding steps */
+__m128 kcl_tri_dot4(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz)
 {
-	octree->root_nodes = NULL;
-	octree->root_node_count = 0;
-	octree->branches = NULL;
-	octree->branch_count = 0;
-	octree->tri_lists = NULL;
-	octree->tri_list_count = 0;
+	__m128 y = _mm_mul_ps(ay, by);
+	__m128d xy_lo = _mm_add_pd(_mm_mul_pd(_mm_cvtps_pd(ax), _mm_cvtps_pd(bx)), _mm_cvtps_pd(y));
+	__m128d xy_hi = _mm_add_pd(_mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(ax, ax)),
+		_mm_cvtps_pd(_mm_movehl_ps(bx, bx))), _mm_cvtps_pd(_mm_movehl_ps(y, y)));
+	__m128 xy = _mm_movelh_ps(_mm_cvtpd_ps(xy_lo), _mm_cvtpd_ps(xy_hi));
+	return _mm_add_ps(xy, _mm_mul_ps(az, bz));
 }
 
-void kcl_octree_free(kcl_octree_t* octree)
+/*
+* Runs the early outs of kcl_tri_collision_hitbox on a group, returns a lane mask
+* of the triangles that pass them. Only rejects what the scalar path would, so
+* survivors go through kcl_tri_collision_hitbox and results don't change.
+* Groups come from calloc, which only promises 8 byte alignment on Win32, so loads are unaligned
+*/
+int kcl_tri_group_filter(kcl_tri_group_t* group, hitbox_t* hitbox, float thickness)
+{
+	__m128 radius = _mm_set1_ps(hitbox->radius);
+
+	__m128i type_bit = _mm_loadu_si128((const __m128i*)group->type_bit);
+	__m128i type_hit = _mm_and_si128(type_bit, _mm_set1_epi32((int)hitbox->flags));
+	__m128 reject = _mm_castsi128_ps(_mm_cmpeq_epi32(type_hit, _mm_setzero_si128()));
+
+	__m128 px = _mm_sub_ps(_mm_set1_ps(hitbox->pos.x), _mm_loadu_ps(group->position.x));
+	__m128 py = _mm_sub_ps(_mm_set1_ps(hitbox->pos.y), _mm_loadu_ps(group->position.y));
+	__m128 pz = _mm_sub_ps(_mm_set1_ps(hitbox->pos.z), _mm_loadu_ps(group->position.z));
+
+	__m128 ca_dist = kcl_tri_dot4(px, py, pz, _mm_loadu_ps(group->ca_normal.x),
+		_mm_loadu_ps(group->ca_normal.y), _mm_loadu_ps(group->ca_normal.z));
+	reject = _mm_or_ps(reject, _mm_cmpge_ps(ca_dist, radius));
+
+	__m128 ab_dist = kcl_tri_dot4(px, py, pz, _mm_loadu_ps(group->ab_normal.x),
+		_mm_loadu_ps(group->ab_normal.y), _mm_loadu_ps(group->ab_normal.z));
+	reject = _mm_or_ps(reject, _mm_cmpge_ps(ab_dist, radius));
+
+	__m128 bc_dist = kcl_tri_dot4(px, py, pz, _mm_loadu_ps(group->bc_normal.x),
+		_mm_loadu_ps(group->bc_normal.y), _mm_loadu_ps(group->bc_normal.z));
+	bc_dist = _mm_sub_ps(bc_dist, _mm_loadu_ps(group->height));
+	reject = _mm_or_ps(reject, _mm_cmpge_ps(bc_dist, radius));
+
+	__m128 plane_dist = kcl_tri_dot4(px, py, pz, _mm_loadu_ps(group->normal.x),
+		_mm_loadu_ps(group->normal.y), _mm_loadu_ps(group->normal.z));
+	__m128 dist_in_plane = _mm_sub_ps(radius, plane_dist);
+	reject = _mm_or_ps(reject, _mm_cmple_ps(dist_in_plane, _mm_setzero_ps()));
+	reject = _mm_or_ps(reject, _mm_cmpge_ps(dist_in_plane, _mm_set1_ps(thickness)));
+
+	return ~_mm_movemask_ps(reject) & 0xF;
+}
+
+void kcl_tri_group_set(kcl_tri_group_t* group, int lane, kcl_tri_t* tri)
+{
+	group->position.x[lane]  = tri->position.x;
+	group->position.y[lane]  = tri->position.y;
+	group->position.z[lane]  = tri->position.z;
+	group->normal.x[lane]    = tri->normal.x;
+	group->normal.y[lane]    = tri->normal.y;
+	group->normal.z[lane]    = tri->normal.z;
+	group->ca_normal.x[lane] = tri->ca_normal.x;
+	group->ca_normal.y[lane] = tri->ca_normal.y;
+	group->ca_normal.z[lane] = tri->ca_normal.z;
+	group->ab_normal.x[lane] = tri->ab_normal.x;
+	group->ab_normal.y[lane] = tri->ab_normal.y;
+	group->ab_normal.z[lane] = tri->ab_normal.z;
+	group->bc_normal.x[lane] = tri->bc_normal.x;
+	group->bc_normal.y[lane] = tri->bc_normal.y;
+	group->bc_normal.z[lane] = tri->bc_normal.z;
+	group->height[lane]      = tri->height;
+	group->type_bit[lane]    = 1u << (tri->attribute & 0x1F);
+}
+
+int kcl_build_tri_groups(kcl_t* kcl)
 {
-	free(octree->root_nodes);
-	free(octree->branches);
+	kcl_octree_t* octree = &kcl->octree;
+
+	uint32_t group_count = 0;
+	for (uint32_t i = 0; i < octree->tri_list_count; i++)
+		group_count += (octree->tri_lists[i].tri_count + 3) / 4;
+
+	/* zeroed so padding lanes never match a hitbox */
+	kcl->tri_groups = calloc(max(group_count, 1), sizeof(*kcl->tri_groups));
+	kcl->tri_group_count = group_count;
+
+	uint32_t group_offset = 0;
 	for (uint32_t i = 0; i < octree->tri_list_count; i++)
-		free(octree->tri_lists[i].tris);
-	free(octree->tri_lists);
+	{
+		kcl_tri_list_t* tri_list = &octree->tri_lists[i];
+		tri_list->group_offset = group_offset;
+
+		uint16_t* tris = &octree->tri_index[tri_list->offset];
+		for (uint32_t j = 0; j < tri_list->tri_count; j++)
+		{
+			if (tris[j] >= kcl->tri_count)
+			{
+				printf("Error, bad triangle index %u in KCL\n", tris[j]);
+				return 0;
+			}
 
+			kcl_tri_group_set(&kcl->tri_groups[group_offset + j / 4], j % 4, &kcl->tris[tris[j]]);
+		}
+
+		group_offset += (tri_list->tri_count + 3) / 4;
+	}
+
+	return 1;
+}
+
+void kcl_octree_init(kcl_octree_t* octree)
+{
+	octree->arena = NULL;
 	octree->root_nodes = NULL;
 	octree->root_node_count = 0;
 	octree->branches = NULL;
 	octree->branch_count = 0;
 	octree->tri_lists = NULL;
 	octree->tri_list_count = 0;
+	octree->tri_index = NULL;
+	octree->tri_index_count = 0;
+}
+
+void kcl_octree_free(kcl_octree_t* octree)
+{
+	free(octree->arena);
+	kcl_octree_init(octree);
 }
 
 bool kcl_octree_parse_node(kcl_raw_node_t* node, bswapstream_t* stream, 
@@ -370,27 +506,25 @@ bool kcl_octree_parse_node(kcl_raw_node_t* node, bswapstream_t* stream,
 }
 
 bool kcl_node_from_raw(kcl_node_t* node, kcl_raw_node_t* raw_node, 
-	uint32_t branches_offset, kcl_raw_tri_list_t* tri_lists, uint32_t tri_list_count)
+	uint32_t branches_offset, uint32_t* leaf_lists, uint32_t leaf_list_count, uint32_t tri_lists_offset)
 {
-	node->type = raw_node->type;
-	if (node->type == kcl_node_leaf)
+	if (raw_node->type == kcl_node_leaf)
 	{
-		uint32_t j;
-		for (j = 0; j < tri_list_count; j++)
-			if (tri_lists[j].offset == raw_node->offset)
-				break;
-	
-		if (j == tri_list_count)
+		/* tri list offsets are 2 byte aligned, so halve them to index the table */
+		uint32_t j = (raw_node->offset - tri_lists_offset) / 2;
+		if ((raw_node->offset - tri_lists_offset) % 2
+			|| j >= leaf_list_count
+			|| leaf_lists[j] == UINT32_MAX)
 		{
 			printf("Error: Failed to match node to tri list in KCL\n");
 			return false;
 		}
 	
-		node->idx = j;
+		*node = KCL_NODE_LEAF | leaf_lists[j];
 	}
-	else if (node->type == kcl_node_branch)
+	else
 	{
-		node->idx = (raw_node->offset - branches_offset) / 32;
+		*node = (raw_node->offset - branches_offset) / 32;
 	}
 
 	return true;
@@ -478,6 +612,7 @@ int kcl_octree_parse(kcl_octree_t* octree, bswapstream_t* stream, uint32_t size)
 
 	kcl_raw_tri_list_t* tri_lists = malloc(sizeof(kcl_raw_tri_list_t) * (tri_list_count + 1));
 	uint32_t tri_list_start_index = 0;
+	uint32_t first_tri_list_offset = tri_lists_offset;
 	tri_list_count = 0;
 
 	for (uint32_t i = 0; i < tri_index_count; i++)
@@ -487,10 +622,8 @@ int kcl_octree_parse(kcl_octree_t* octree, bswapstream_t* stream, uint32_t size)
 		{
 			kcl_raw_tri_list_t* tri_list = &tri_lists[tri_list_count++];
 
+			tri_list->first = tri_list_start_index;
 			tri_list->tri_count = i - tri_list_start_index;
-			tri_list->tris = malloc(tri_list->tri_count * sizeof(*tri_list->tris));
-			for (uint32_t j = 0; j < tri_list->tri_count; j++)
-				tri_list->tris[j] = tri_index[tri_list_start_index + j];
 			tri_list->offset = tri_lists_offset;
 
 			tri_list_start_index = i + 1;
@@ -498,27 +631,50 @@ int kcl_octree_parse(kcl_octree_t* octree, bswapstream_t* stream, uint32_t size)
 		}
 	}
 
-	free(tri_index);
-
 	kcl_raw_tri_list_t* last_tri_list = &tri_lists[tri_list_count++];
-	last_tri_list->tris = NULL;
+	last_tri_list->first = tri_index_count;
 	last_tri_list->tri_count = 0;
 	last_tri_list->offset = tri_lists_offset - 2;
 
-	octree->root_node_count = root_node_count;
-	octree->root_nodes = malloc(octree->root_node_count * sizeof(*octree->root_nodes));
+	/* tri list index by offset, the first list wins when an empty list shares one */
+	uint32_t leaf_list_count = tri_index_count + 1;
+	uint32_t* leaf_lists = malloc(leaf_list_count * sizeof(*leaf_lists));
+	for (uint32_t i = 0; i < leaf_list_count; i++)
+		leaf_lists[i] = UINT32_MAX;
+
+	for (uint32_t i = 0; i < tri_list_count; i++)
+	{
+		uint32_t j = (tri_lists[i].offset - first_tri_list_offset) / 2;
+		if (j < leaf_list_count && leaf_lists[j] == UINT32_MAX)
+			leaf_lists[j] = i;
+	}
+
+	/* one allocation for the whole octree, branches first as they're hit hardest */
+	size_t branches_size   = branch_count * sizeof(kcl_branch_t);
+	size_t root_nodes_size = root_node_count * sizeof(kcl_node_t);
+	size_t tri_lists_size  = tri_list_count * sizeof(kcl_tri_list_t);
+	size_t tri_index_bytes = tri_index_count * sizeof(uint16_t);
+	uint8_t* arena = malloc(branches_size + root_nodes_size + tri_lists_size + tri_index_bytes);
+
+	octree->arena			= arena;
+	octree->branches		= (kcl_branch_t*)arena;
+	octree->branch_count	= branch_count;
+	octree->root_nodes		= (kcl_node_t*)(arena + branches_size);
+	octree->root_node_count	= root_node_count;
+	octree->tri_lists		= (kcl_tri_list_t*)(arena + branches_size + root_nodes_size);
+	octree->tri_list_count	= tri_list_count;
+	octree->tri_index		= (uint16_t*)(arena + branches_size + root_nodes_size + tri_lists_size);
+	octree->tri_index_count	= tri_index_count;
+
 	for (uint32_t i = 0; i < octree->root_node_count; i++)
 	{
 		if (!kcl_node_from_raw(&octree->root_nodes[i], &root_nodes[i],
-			branches_offset, tri_lists, tri_list_count))
+			branches_offset, leaf_lists, leaf_list_count, first_tri_list_offset))
 		{
 			goto cleanup;
 		}
 	}
 
-	octree->branch_count = branch_count;
-	octree->branches = malloc(octree->branch_count * sizeof(*octree->branches));
-
 	for (uint32_t i = 0; i < octree->branch_count; i++)
 	{
 		kcl_node_t* nodes = octree->branches[i].nodes;
@@ -527,68 +683,162 @@ int kcl_octree_parse(kcl_octree_t* octree, bswapstream_t* stream, uint32_t size)
 		for (int j = 0; j < 8; j++)
 		{
 			if (!kcl_node_from_raw(&nodes[j], &raw_nodes[j],
-				branches_offset, tri_lists, tri_list_count))
+				branches_offset, leaf_lists, leaf_list_count, first_tri_list_offset))
 			{
 				goto cleanup;
 			}
 		}
 	}
 
-	octree->tri_list_count = tri_list_count;
-	octree->tri_lists = malloc(octree->tri_list_count * sizeof(*octree->tri_lists));
 	for (uint32_t i = 0; i < octree->tri_list_count; i++)
 	{
 		kcl_tri_list_t* tri_list = &octree->tri_lists[i];
 		kcl_raw_tri_list_t* raw_tri_list = &tri_lists[i];
 
-		tri_list->tris = raw_tri_list->tris;
+		tri_list->offset = raw_tri_list->first;
 		tri_list->tri_count = raw_tri_list->tri_count;
 	}
 
+	/* lists stay in place, terminators included */
+	memcpy(octree->tri_index, tri_index, tri_index_bytes);
+
 	ret = 1;
 
 cleanup:
 	free(root_nodes);
 	free(branches);
+	free(tri_index);
 	free(tri_lists);
+	free(leaf_lists);
 
 	return ret;
 }
 
-kcl_tri_list_t* kcl_octree_find(kcl_octree_t* octree, kcl_header_t* header, vec3_t* pos)
+/* leaf cell of a position, any position with the same cell >> shift is in the same leaf */
+typedef struct
+{
+	kcl_tri_list_t*	tri_list;
+	uint32_t		x, y, z;
+	uint32_t		shift;
+} kcl_leaf_t;
+
+bool kcl_octree_find_leaf(kcl_octree_t* octree, kcl_header_t* header, vec3_t* pos, kcl_leaf_t* leaf)
 {
 	uint32_t x = (uint32_t)(pos->x - header->origin.x);
 	if ((x & header->x_mask) != 0)
-		return NULL;
+		return false;
 
 	uint32_t y = (uint32_t)(pos->y - header->origin.y);
 	if ((y & header->y_mask) != 0)
-		return NULL;
+		return false;
 
 	uint32_t z = (uint32_t)(pos->z - header->origin.z);
 	if ((z & header->z_mask) != 0)
-		return NULL;
+		return false;
 
 	uint32_t shift = header->shift;
 	uint32_t node_idx = (z >> shift) << header->z_shift;
 	node_idx |= (y >> shift) << header->y_shift;
 	node_idx |= x >> shift;
 
-	kcl_node_t* node = &octree->root_nodes[node_idx];
-	for (;;)
+	kcl_node_t node = octree->root_nodes[node_idx];
+	while (!KCL_NODE_IS_LEAF(node))
+	{
+		kcl_branch_t* branch = &octree->branches[node];
+		shift -= 1;
+		node_idx = (z >> shift & 1) << 2 | (y >> shift & 1) << 1 | (x >> shift & 1);
+		node = branch->nodes[node_idx];
+	}
+
+	leaf->tri_list = &octree->tri_lists[KCL_NODE_INDEX(node)];
+	leaf->x = x;
+	leaf->y = y;
+	leaf->z = z;
+	leaf->shift = shift;
+	return true;
+}
+
+/*
+* Every index the octree walk and collision follow is in range, and branches only
+* point forward so a walk ends. kcl_parse builds all of this itself, an octree
+* mapped from elsewhere is only trusted after this
+*/
+int kcl_octree_check(kcl_t* kcl)
+{
+	kcl_header_t* header = &kcl->header;
+	kcl_octree_t* octree = &kcl->octree;
+
+	if (header->shift >= 32 || header->y_shift >= 32 || header->z_shift >= 32)
+	{
+		printf("Error: bad KCL octree shifts\n");
+		return 0;
+	}
+
+	uint64_t root_max = ((uint64_t)(~header->z_mask >> header->shift) << header->z_shift)
+		| ((uint64_t)(~header->y_mask >> header->shift) << header->y_shift)
+		| (~header->x_mask >> header->shift);
+	if (root_max >= octree->root_node_count)
+	{
+		printf("Error: KCL octree has %u root nodes, masks need %" PRIu64 "\n", octree->root_node_count, root_max + 1);
+		return 0;
+	}
+
+	for (uint32_t i = 0; i < octree->root_node_count; i++)
+	{
+		kcl_node_t node = octree->root_nodes[i];
+		if (KCL_NODE_INDEX(node) >= (KCL_NODE_IS_LEAF(node) ? octree->tri_list_count : octree->branch_count))
+		{
+			printf("Error: KCL root node %u out of range\n", i);
+			return 0;
+		}
+	}
+
+	for (uint32_t i = 0; i < octree->branch_count; i++)
+	{
+		for (int j = 0; j < 8; j++)
+		{
+			kcl_node_t node = octree->branches[i].nodes[j];
+			bool ok = KCL_NODE_IS_LEAF(node)
+				? KCL_NODE_INDEX(node) < octree->tri_list_count
+				: node > i && node < octree->branch_count;
+			if (!ok)
+			{
+				printf("Error: KCL branch %u node %d out of range\n", i, j);
+				return 0;
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < octree->tri_list_count; i++)
 	{
-		if (node->type == kcl_node_leaf)
+		kcl_tri_list_t* tri_list = &octree->tri_lists[i];
+		if ((uint64_t)tri_list->offset + tri_list->tri_count > octree->tri_index_count
+			|| (uint64_t)tri_list->group_offset + (tri_list->tri_count + 3) / 4 > kcl->tri_group_count)
 		{
-			return &octree->tri_lists[node->idx];
+			printf("Error: KCL tri list %u out of range\n", i);
+			return 0;
 		}
-		else if (node->type == kcl_node_branch)
+
+		for (uint32_t j = 0; j < tri_list->tri_count; j++)
 		{
-			kcl_branch_t* branch = &octree->branches[node->idx];
-			shift -= 1;
-			node_idx = (z >> shift & 1) << 2 | (y >> shift & 1) << 1 | (x >> shift & 1);
-			node = &branch->nodes[node_idx];
+			if (octree->tri_index[tri_list->offset + j] >= kcl->tri_count)
+			{
+				printf("Error: KCL tri list %u has a bad triangle\n", i);
+				return 0;
+			}
 		}
 	}
+
+	return 1;
+}
+
+kcl_tri_list_t* kcl_octree_find(kcl_octree_t* octree, kcl_header_t* header, vec3_t* pos)
+{
+	kcl_leaf_t leaf;
+	if (!kcl_octree_find_leaf(octree, header, pos, &leaf))
+		return NULL;
+
+	return leaf.tri_list;
 }
 
 void kcl_init(kcl_t* kcl)
@@ -599,6 +849,8 @@ void kcl_init(kcl_t* kcl)
 	kcl->tri_count = 0;
 	kcl->vertex_count = 0;
 	kcl_octree_init(&kcl->octree);
+	kcl->tri_groups = NULL;
+	kcl->tri_group_count = 0;
 }
 
 void kcl_free(kcl_t* kcl)
@@ -606,8 +858,11 @@ void kcl_free(kcl_t* kcl)
 	kcl_octree_free(&kcl->octree);
 	free(kcl->tris);
 	free(kcl->vertices);
+	free(kcl->tri_groups);
 	kcl->tris = NULL;
 	kcl->vertices = NULL;
+	kcl->tri_groups = NULL;
+	kcl->tri_group_count = 0;
 }
 
 int kcl_parse(kcl_t* kcl, bin_t* bin)
@@ -720,6 +975,9 @@ int kcl_parse(kcl_t* kcl, bin_t* bin)
 	if (!kcl_octree_parse(&kcl->octree, &stream, octree_size))
 		goto cleanup;
 
+	if (!kcl_build_tri_groups(kcl))
+		goto cleanup;
+
 	ret = 1;
 
 cleanup:
@@ -733,20 +991,137 @@ cleanup:
 
 void kcl_collision_hitbox(kcl_t* kcl, hitbox_t* hitbox, collision_t* collision)
 {
-	collision_init(collision);
+	kcl_collision_hitboxes(kcl, &hitbox, 1, collision);
+}
+
+/* tests a leaf's triangles against every hitbox in it, each hitbox still sees them in order */
+void kcl_collision_leaf(kcl_t* kcl, kcl_tri_list_t* tri_list, hitbox_t** hitboxes,
+	collision_t* out, int* members, int member_count)
+{
+	float thickness = kcl->header.thickness;
+	uint16_t* tris = &kcl->octree.tri_index[tri_list->offset];
+	kcl_tri_group_t* groups = &kcl->tri_groups[tri_list->group_offset];
+
+	for (uint32_t i = 0; i < tri_list->tri_count; i += 4)
+	{
+		kcl_tri_group_t* group = &groups[i / 4];
+		for (int k = 0; k < member_count; k++)
+		{
+			hitbox_t* hitbox = hitboxes[members[k]];
+			int mask = kcl_tri_group_filter(group, hitbox, thickness);
+			for (int j = 0; mask != 0; j++, mask >>= 1)
+			{
+				if ((mask & 1) == 0)
+					continue;
+
+				kcl_tri_t* tri = &kcl->tris[tris[i + j]];
+				collision_tri_t collision_tri;
+				if (kcl_tri_collision_hitbox(tri, hitbox, thickness, &collision_tri))
+				{
+					collision_add_tri(&out[members[k]], &collision_tri);
+				}
+			}
+		}
+	}
+}
 
-	kcl_tri_list_t* tri_list = kcl_octree_find(&kcl->octree, &kcl->header, &hitbox->pos);
-	if (tri_list)
+void kcl_collision_hitboxes(kcl_t* kcl, hitbox_t** hitboxes, int count, collision_t* out)
+{
+	for (int base = 0; base < count; base += kcl_max_batch)
 	{
-		float thickness = kcl->header.thickness;
-		for (uint32_t i = 0; i < tri_list->tri_count; i++)
+		int batch_count = min(count - base, kcl_max_batch);
+		kcl_leaf_t leaves[kcl_max_batch];
+		int leaf_of[kcl_max_batch];
+		int leaf_count = 0;
+
+		for (int i = 0; i < batch_count; i++)
+		{
+			hitbox_t* hitbox = hitboxes[base + i];
+			collision_init(&out[base + i]);
+			leaf_of[i] = -1;
+
+			/*
+			* Every position agreeing on the cell bits above a leaf's shift walks
+			* the same path down the octree, so it ends in that leaf
+			*/
+			kcl_header_t* header = &kcl->header;
+			uint32_t x = (uint32_t)(hitbox->pos.x - header->origin.x);
+			uint32_t y = (uint32_t)(hitbox->pos.y - header->origin.y);
+			uint32_t z = (uint32_t)(hitbox->pos.z - header->origin.z);
+			hitbox->leaf_lookups++;
+
+			/* still in the leaf from the last query */
+			uint32_t shift = hitbox->leaf_shift;
+			if (hitbox->leaf_kcl == kcl
+				&& (x >> shift) == hitbox->leaf_x
+				&& (y >> shift) == hitbox->leaf_y
+				&& (z >> shift) == hitbox->leaf_z)
+			{
+				hitbox->leaf_hits++;
+
+				kcl_leaf_t* leaf = &leaves[leaf_count];
+				leaf->tri_list = &kcl->octree.tri_lists[hitbox->leaf_idx];
+				leaf->x = x;
+				leaf->y = y;
+				leaf->z = z;
+				leaf->shift = shift;
+
+				/* may still share it with an earlier hitbox in the batch */
+				for (int j = 0; j < leaf_count && leaf_of[i] < 0; j++)
+				{
+					if (leaves[j].tri_list == leaf->tri_list)
+						leaf_of[i] = j;
+				}
+
+				if (leaf_of[i] < 0)
+					leaf_of[i] = leaf_count++;
+				continue;
+			}
+
+			/* reuse a leaf found for an earlier hitbox when this one lands in its cell */
+			for (int j = 0; j < leaf_count; j++)
+			{
+				kcl_leaf_t* leaf = &leaves[j];
+				if ((x >> leaf->shift) == (leaf->x >> leaf->shift)
+					&& (y >> leaf->shift) == (leaf->y >> leaf->shift)
+					&& (z >> leaf->shift) == (leaf->z >> leaf->shift))
+				{
+					leaf_of[i] = j;
+					break;
+				}
+			}
+
+			if (leaf_of[i] < 0)
+			{
+				if (!kcl_octree_find_leaf(&kcl->octree, header, &hitbox->pos, &leaves[leaf_count]))
+				{
+					hitbox->leaf_kcl = NULL;
+					continue;
+				}
+
+				leaf_of[i] = leaf_count++;
+			}
+
+			kcl_leaf_t* leaf = &leaves[leaf_of[i]];
+			hitbox->leaf_kcl = kcl;
+			hitbox->leaf_idx = (uint32_t)(leaf->tri_list - kcl->octree.tri_lists);
+			hitbox->leaf_x = x >> leaf->shift;
+			hitbox->leaf_y = y >> leaf->shift;
+			hitbox->leaf_z = z >> leaf->shift;
+			hitbox->leaf_shift = leaf->shift;
+		}
+
+		for (int j = 0; j < leaf_count; j++)
 		{
-			kcl_tri_t* tri = &kcl->tris[tri_list->tris[i]];
-			collision_tri_t collision_tri;
-			if (kcl_tri_collision_hitbox(tri, hitbox, thickness, &collision_tri))
+			int members[kcl_max_batch];
+			int member_count = 0;
+			for (int i = 0; i < batch_count; i++)
 			{
-				collision_add_tri(collision, &collision_tri);
+				if (leaf_of[i] == j)
+					members[member_count++] = i;
 			}
+
+			kcl_collision_leaf(kcl, leaves[j].tri_list, hitboxes + base, out + base, members, member_count);
 		}
 	}
 }
@@ -778,7 +1153,7 @@ void kcl_write_obj(kcl_t* kcl, const char* name)
 
 parser_t kcl_parser =
 {
-	kcl_init,
-	kcl_free,
-	kcl_parse,
+	(parser_init_t)kcl_init,
+	(parser_free_t)kcl_free,
+	(parser_parse_t)kcl_parse,
 };
\ No newline at end of file
@@ -120,13 +120,20 @@ typedef struct
 
 enum { collision_max_hits = 64 };
 
+/*
+* Only the furthest hit of each surface kind is kept, which is all
+* collision_find_furthest needs. Like a list capped at collision_max_hits,
+* hits past the cap are ignored and earlier hits win ties
+*/
 typedef struct collision_t
 {
 	vec3_t		min;
 	vec3_t		max;
 	float		floor_dist;
 	vec3_t		floor_normal;
-	hit_t		hits[collision_max_hits];
+	hit_t		furthest[COL_TYPE_COUNT];
+	uint8_t		furthest_order[COL_TYPE_COUNT];
+	uint32_t	furthest_kinds;
 	int			hit_count;
 	uint32_t	surface_kinds;
 } collision_t;
@@ -143,10 +150,21 @@ typedef struct hitbox_t
 	float		radius;
 	uint32_t	flags;
 	bool		last_pos_valid;
+
+	/* last octree leaf, reused while pos stays in the same cell */
+	const struct kcl_t* leaf_kcl;
+	uint32_t	leaf_idx;
+	uint32_t	leaf_x;
+	uint32_t	leaf_y;
+	uint32_t	leaf_z;
+	uint32_t	leaf_shift;
+	uint32_t	leaf_lookups;
+	uint32_t	leaf_hits;
 } hitbox_t;
 
 void hitbox_init(hitbox_t* hitbox, vec3_t* pos, vec3_t* last_pos, float radius, uint32_t flags);
 void hitbox_update_pos(hitbox_t* hitbox, vec3_t* pos);
+void hitbox_reset_leaf(hitbox_t* hitbox);
 
 typedef struct
 {
@@ -165,11 +183,12 @@ typedef struct
 	float		sphere_radius;
 } kcl_header_t;
 
-typedef struct
-{
-	uint8_t		type;
-	uint32_t	idx;
-} kcl_node_t;
+/* branch index, or tri list index tagged with KCL_NODE_LEAF */
+typedef uint32_t kcl_node_t;
+
+#define KCL_NODE_LEAF			0x80000000
+#define KCL_NODE_IS_LEAF(x)		(((x) & KCL_NODE_LEAF) != 0)
+#define KCL_NODE_INDEX(x)		((x) & ~KCL_NODE_LEAF)
 
 typedef struct
 {
@@ -178,18 +197,22 @@ typedef struct
 
 typedef struct
 {
-	uint16_t*	tris;
+	uint32_t	offset;		/* first entry in kcl_octree_t tri_index */
 	uint32_t	tri_count;
+	uint32_t	group_offset;	/* first kcl_tri_group_t in kcl_t tri_groups */
 } kcl_tri_list_t;
 
 typedef struct
 {
+	void*			arena;		/* owns every array below, NULL when mapped */
 	kcl_node_t*		root_nodes;
 	uint32_t		root_node_count;
 	kcl_branch_t*	branches;
 	uint32_t		branch_count;
 	kcl_tri_list_t* tri_lists;
 	uint32_t		tri_list_count;
+	uint16_t*		tri_index;
+	uint32_t		tri_index_count;
 } kcl_octree_t;
 
 typedef struct
@@ -210,6 +233,28 @@ typedef struct
 	vec3_t		color;
 } kcl_tri_vertex_t;
 
+typedef struct
+{
+	float		x[4];
+	float		y[4];
+	float		z[4];
+} kcl_vec3x4_t;
+
+/*
+* Four consecutive triangles of a tri list in SoA layout, for testing them
+* against a hitbox at once. Unused lanes have a zero type_bit
+*/
+typedef struct
+{
+	kcl_vec3x4_t position;
+	kcl_vec3x4_t normal;
+	kcl_vec3x4_t ca_normal;
+	kcl_vec3x4_t ab_normal;
+	kcl_vec3x4_t bc_normal;
+	float		 height[4];
+	uint32_t	 type_bit[4];
+} kcl_tri_group_t;
+
 typedef struct kcl_t
 {
 	kcl_header_t header;
@@ -218,9 +263,15 @@ typedef struct kcl_t
 	uint32_t	 tri_count;
 	uint32_t	 vertex_count;
 	kcl_octree_t octree;
+	kcl_tri_group_t* tri_groups;
+	uint32_t	 tri_group_count;
 } kcl_t;
 
-void kcl_collision_hitbox(kcl_t* kcl, hitbox_t* hitbox, collision_t* collision);
+enum { kcl_max_batch = 16 };
+
+void kcl_collision_hitbox  (kcl_t* kcl, hitbox_t* hitbox, collision_t* collision);
+void kcl_collision_hitboxes(kcl_t* kcl, hitbox_t** hitboxes, int count, collision_t* out);
 void kcl_write_obj(kcl_t* kcl, const char* name);
+int  kcl_octree_check(kcl_t* kcl);
 
 extern parser_t kcl_parser;
\ No newline at end of file
@@ -227,7 +227,7 @@ void* ckph_parse(kmp_section_header_t* header, bswapstream_t* stream)
 
 parser_t kmp_parser =
 {
-	kmp_init,
-	kmp_free,
-	kmp_parse,
+	(parser_init_t)kmp_init,
+	(parser_free_t)kmp_free,
+	(parser_parse_t)kmp_parse,
 };
\ No newline at end of file
@@ -108,7 +108,7 @@ int param_parse(param_t* param, bin_t* bin)
 
 parser_t param_parser =
 {
-    param_init,
-    param_free,
-    param_parse
+    (parser_init_t)param_init,
+    (parser_free_t)param_free,
+    (parser_parse_t)param_parse
 };
\ No newline at end of file
@@ -17,19 +17,18 @@ void rkg_free(rkg_t* rkg)
     rkg->frame_count = 0;
 }
 
-int rkg_parse(rkg_t* rkg, bin_t* rkg_buffer)
+int rkg_parse_header(rkg_header_t* header, uint8_t* buffer)
 {
-    if (strncmp((char*)rkg_buffer->buffer, "RKGD", 4))
+    if (strncmp((char*)buffer, "RKGD", 4))
     {
         printf("Error reading RKGD, bad header\n");
         return 0;
     }
 
-    rkg_header_t* header = &rkg->header;
     rkg_time_t* finish_time = &header->finish_time;
 
     bitstream_t stream;
-    bitstream_init(&stream, rkg_buffer->buffer);
+    bitstream_init(&stream, buffer);
 
                                  bitstream_read_skip  (&stream, 32);
     finish_time->minutes       = bitstream_read_uint8 (&stream, 7);
@@ -67,12 +66,48 @@ int rkg_parse(rkg_t* rkg, bin_t* rkg_buffer)
         header->mii_data[i]    = bitstream_read_uint8 (&stream, 8);
     header->crc16              = bitstream_read_uint16(&stream, 16);
 
-    if (stream.pos != 0x88*8)
+    if (stream.pos != rkg_header_size*8)
+    {
+        printf("Error reading RKGD header (expected: %d, got %d)\n", rkg_header_size*8, stream.pos);
+        return 0;
+    }
+
+    return 1;
+}
+
+int rkg_read_header(rkg_header_t* header, const char* filename)
+{
+    FILE* file = fopen(filename, "rb");
+    if (!file)
+        return 0;
+
+    uint8_t buffer[rkg_header_size];
+    size_t size = fread(buffer, 1, sizeof(buffer), file);
+    fclose(file);
+
+    if (size != sizeof(buffer))
+        return 0;
+
+    return rkg_parse_header(header, buffer);
+}
+
+int rkg_parse(rkg_t* rkg, bin_t* rkg_buffer)
+{
+    if (rkg_buffer->size < rkg_header_size)
     {
-        printf("Error reading RKGD header (expected: %d, got %d)\n", 0x88*8, stream.pos);
+        printf("Error reading RKGD, file too small\n");
         return 0;
     }
 
+    if (!rkg_parse_header(&rkg->header, rkg_buffer->buffer))
+        return 0;
+
+    rkg_header_t* header = &rkg->header;
+
+    bitstream_t stream;
+    bitstream_init(&stream, rkg_buffer->buffer);
+    bitstream_read_skip(&stream, rkg_header_size*8);
+
     bin_t input;
     if (header->compressed_flag)
     {
@@ -192,7 +227,7 @@ int rkg_parse(rkg_t* rkg, bin_t* rkg_buffer)
 
 parser_t rkg_parser =
 {
-    rkg_init,
-    rkg_free,
-    rkg_parse,
+    (parser_init_t)rkg_init,
+    (parser_free_t)rkg_free,
+    (parser_parse_t)rkg_parse,
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 enum { rkg_max_size = 0x2774 };
+enum { rkg_header_size = 0x88 };
 
 typedef struct input_t input_t;
 
@@ -54,4 +55,6 @@ typedef struct rkg_t
     char                name[_MAX_PATH];
 } rkg_t;
 
+int rkg_read_header(rkg_header_t* header, const char* filename);
+
 extern parser_t rkg_parser;
\ No newline at end of file
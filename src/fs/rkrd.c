@@ -1,26 +1,51 @@
 #include "../common.h"
 #include "../physics/physics.h"
 #include "rkrd.h"
+#include "rkrz.h"
+
+#include <emmintrin.h>
 
 void rkrd_init(rkrd_t* rkrd)
 {
+    bin_init(&rkrd->file);
+    rkrd->mapped = false;
+    rkrd->compact = false;
     rkrd->frames = NULL;
+    rkrd->chunk_start = UINT32_MAX;
+    rkrd->damaged = false;
     rkrd->frame_count = 0;
     rkrd->frame_desync = UINT32_MAX;
+    rkrd->desync.field_mask = 0;
+    memset(&rkrd->stats, 0, sizeof(rkrd->stats));
 }
 
 void rkrd_free(rkrd_t* rkrd)
 {
+    if (rkrd->mapped)
+        bin_unmap(&rkrd->file);
+    else
+        bin_free(&rkrd->file);
+
     free(rkrd->frames);
-    rkrd->frames = NULL;
-    rkrd->frame_count = 0;
-    rkrd->frame_desync = UINT32_MAX;
+    rkrd_init(rkrd);
 }
 
-int rkrd_parse(rkrd_t* rkrd, bin_t* rkrd_buffer)
+/* checks the header and frame size of an .rkrd or .rkrz, frames are decoded later a chunk at a time by rkrd_frame */
+int rkrd_parse_header(rkrd_t* rkrd, bin_t* rkrd_buffer)
 {
     rkrd_header_t* header = (rkrd_header_t*)rkrd_buffer->buffer;
-    if (strncmp(header->id, "RKRD", 4))
+    if (rkrd_buffer->size >= sizeof(rkrd_header_t) && !strncmp(header->id, "RKRZ", 4))
+    {
+        if (!rkrz_parse_header(rkrd, rkrd_buffer))
+            return 0;
+
+        rkrd->compact = true;
+        rkrd->frames = malloc(RKRD_CHUNK_FRAMES * sizeof(rkrd_values_t));
+        rkrd->chunk_start = UINT32_MAX;
+        return 1;
+    }
+
+    if (rkrd_buffer->size < sizeof(rkrd_header_t) || strncmp(header->id, "RKRD", 4))
     {
         printf("Error reading RKRD, bad header\n");
         return 0;
@@ -45,87 +70,435 @@ int rkrd_parse(rkrd_t* rkrd, bin_t* rkrd_buffer)
     }
 
     rkrd->frame_count = size / sizeof(rkrd_frame_t);
-    rkrd->frames = malloc(rkrd->frame_count * sizeof(rkrd_frame_t));
+    rkrd->frames = malloc(RKRD_CHUNK_FRAMES * sizeof(rkrd_values_t));
+    rkrd->chunk_start = UINT32_MAX;
+    return 1;
+}
+
+/* keeps its own copy of the buffer, rkrd_open maps the file instead */
+int rkrd_parse(rkrd_t* rkrd, bin_t* rkrd_buffer)
+{
+    if (!rkrd_parse_header(rkrd, rkrd_buffer))
+        return 0;
 
-    for (size_t i = 0; i < rkrd->frame_count; i++)
+    bin_copy(&rkrd->file, rkrd_buffer);
+    rkrd->mapped = false;
+    return 1;
+}
+
+int rkrd_open(rkrd_t* rkrd, const char* filename)
+{
+    rkrd_init(rkrd);
+
+    bin_t file;
+    if (!bin_map(&file, filename))
     {
-        rkrd_frame_t* frame         = &rkrd->frames[i];
-        frame->rot_vec2             = bswapstream_read_vec3(&stream);
-        frame->speed1_soft_limit    = bswapstream_read_float(&stream);
-        frame->speed1               = bswapstream_read_float(&stream);
-        frame->floor_nor            = bswapstream_read_vec3(&stream);
-        frame->dir                  = bswapstream_read_vec3(&stream);
-        frame->pos                  = bswapstream_read_vec3(&stream);
-        frame->vel0                 = bswapstream_read_vec3(&stream);
-        frame->rot_vec0             = bswapstream_read_vec3(&stream);
-        frame->vel2                 = bswapstream_read_vec3(&stream);
-        frame->vel                  = bswapstream_read_vec3(&stream);
-        frame->main_rot             = bswapstream_read_quat(&stream);
-        frame->full_rot             = bswapstream_read_quat(&stream);
-        frame->animation            = bswapstream_read_uint16(&stream);
-        frame->checkpoint_idx       = bswapstream_read_uint16(&stream);
+        printf("Couldn't open %s\n", filename);
+        return 0;
     }
 
-    int ret = 1;
-    uint32_t size_read = (uint32_t)bswapstream_current_read(&stream) - sizeof(rkrd_header_t);
-    if (size_read != size)
+    if (!rkrd_parse_header(rkrd, &file))
     {
-        printf("Error reading input data (expected: %u, got %u)\n", size, size_read);
-        ret = 0;
+        printf("Couldn't parse %s\n", filename);
+        bin_unmap(&file);
+        return 0;
     }
 
+    /* a packed file is only good while the .rkrd it came from hasn't changed */
+    char source_path[_MAX_PATH];
+    strext(source_path, filename, "rkrd");
+    if (rkrd->compact && !rkrz_check_source(&file, filename, source_path))
+    {
+        rkrd_free(rkrd);
+        bin_unmap(&file);
+        return 0;
+    }
+
+    rkrd->file = file;
+    rkrd->mapped = true;
+    return 1;
+}
+
+/* where a chunk's frames are in the file */
+int rkrd_chunk_range(rkrd_t* rkrd, uint32_t chunk, size_t* offset, size_t* size)
+{
+    if (rkrd->compact)
+        return rkrz_block_range(&rkrd->file, chunk, offset, size);
+
+    uint32_t chunk_start = chunk * RKRD_CHUNK_FRAMES;
+    if (chunk_start >= rkrd->frame_count)
+        return 0;
+
+    *offset = sizeof(rkrd_header_t) + (size_t)chunk_start * sizeof(rkrd_frame_t);
+    *size = (size_t)min(RKRD_CHUNK_FRAMES, rkrd->frame_count - chunk_start) * sizeof(rkrd_frame_t);
     return 1;
 }
 
-bool rkrd_check_desync(rkrd_frame_t* frame, physics_t* physics)
+void rkrd_read_frame(bswapstream_t* stream, rkrd_values_t* values)
+{
+    rkrd_frame_t frame;
+    frame.rot_vec2              = bswapstream_read_vec3(stream);
+    frame.speed1_soft_limit     = bswapstream_read_float(stream);
+    frame.speed1                = bswapstream_read_float(stream);
+    frame.floor_nor             = bswapstream_read_vec3(stream);
+    frame.dir                   = bswapstream_read_vec3(stream);
+    frame.pos                   = bswapstream_read_vec3(stream);
+    frame.vel0                  = bswapstream_read_vec3(stream);
+    frame.rot_vec0              = bswapstream_read_vec3(stream);
+    frame.vel2                  = bswapstream_read_vec3(stream);
+    frame.vel                   = bswapstream_read_vec3(stream);
+    frame.main_rot              = bswapstream_read_quat(stream);
+    frame.full_rot              = bswapstream_read_quat(stream);
+    frame.animation             = bswapstream_read_uint16(stream);
+    frame.checkpoint_idx        = bswapstream_read_uint16(stream);
+    rkrd_values_frame(values, &frame);
+}
+
+/*
+	decodes the chunk holding frame_idx when the cursor leaves the current one,
+	and asks the OS to start reading the next chunk while this one is simulated.
+	NULL and damaged set when the chunk can't be decoded
+*/
+rkrd_values_t* rkrd_frame(rkrd_t* rkrd, uint32_t frame_idx)
+{
+    uint32_t chunk_start = frame_idx - frame_idx % RKRD_CHUNK_FRAMES;
+    if (chunk_start != rkrd->chunk_start)
+    {
+        uint32_t chunk = chunk_start / RKRD_CHUNK_FRAMES;
+        uint32_t count = min(RKRD_CHUNK_FRAMES, rkrd->frame_count - chunk_start);
+
+        if (rkrd->compact)
+        {
+            if (!rkrz_decode_block(&rkrd->file, chunk, rkrd->frames, count))
+            {
+                rkrd->chunk_start = UINT32_MAX;
+                rkrd->damaged = true;
+                return NULL;
+            }
+        }
+        else
+        {
+            size_t offset = sizeof(rkrd_header_t) + (size_t)chunk_start * sizeof(rkrd_frame_t);
+
+            bswapstream_t stream;
+            bswapstream_init(&stream, rkrd->file.buffer + offset);
+            for (uint32_t i = 0; i < count; i++)
+                rkrd_read_frame(&stream, &rkrd->frames[i]);
+        }
+
+        rkrd->chunk_start = chunk_start;
+
+        size_t next_offset, next_size;
+        if (rkrd->mapped && rkrd_chunk_range(rkrd, chunk + 1, &next_offset, &next_size) && next_size > 0)
+            bin_prefetch(&rkrd->file, next_offset, next_size);
+    }
+
+    return &rkrd->frames[frame_idx - chunk_start];
+}
+
+const char* rkrd_field_names[rkrd_field_max] =
+{
+	"up", "dir", "pos", "vel0", "speed1", "vel", "rot_vec0", "rot_vec2", "main_rot", "full_rot",
+};
+
+const int rkrd_field_sizes[rkrd_field_max] =
+{
+	3, 3, 3, 3, 1, 3, 3, 3, 4, 4,
+};
+
+void rkrd_values_vec3(rkrd_values_t* values, int field, const vec3_t* v)
+{
+	memcpy(values->values[field], v->v, sizeof(v->v));
+}
+
+void rkrd_values_quat(rkrd_values_t* values, int field, const quat_t* q)
+{
+	memcpy(values->values[field], q->v, sizeof(q->v));
+}
+
+void rkrd_values_frame(rkrd_values_t* values, rkrd_frame_t* frame)
+{
+	memset(values, 0, sizeof(*values));
+	rkrd_values_vec3(values, rkrd_field_up,		  &frame->floor_nor);
+	rkrd_values_vec3(values, rkrd_field_dir,	  &frame->dir);
+	rkrd_values_vec3(values, rkrd_field_pos,	  &frame->pos);
+	rkrd_values_vec3(values, rkrd_field_vel0,	  &frame->vel0);
+	values->values[rkrd_field_speed1][0] = frame->speed1;
+	rkrd_values_vec3(values, rkrd_field_vel,	  &frame->vel);
+	rkrd_values_vec3(values, rkrd_field_rot_vec0, &frame->rot_vec0);
+	rkrd_values_vec3(values, rkrd_field_rot_vec2, &frame->rot_vec2);
+	rkrd_values_quat(values, rkrd_field_main_rot, &frame->main_rot);
+	rkrd_values_quat(values, rkrd_field_full_rot, &frame->full_rot);
+}
+
+void rkrd_values_physics(rkrd_values_t* values, physics_t* physics)
+{
+	memset(values, 0, sizeof(*values));
+	rkrd_values_vec3(values, rkrd_field_up,		  &physics->up);
+	rkrd_values_vec3(values, rkrd_field_dir,	  &physics->dir);
+	rkrd_values_vec3(values, rkrd_field_pos,	  &physics->pos);
+	rkrd_values_vec3(values, rkrd_field_vel0,	  &physics->vel0);
+	values->values[rkrd_field_speed1][0] = physics->speed1;
+	rkrd_values_vec3(values, rkrd_field_vel,	  &physics->vel);
+	rkrd_values_vec3(values, rkrd_field_rot_vec0, &physics->rot_vec0);
+	rkrd_values_vec3(values, rkrd_field_rot_vec2, &physics->rot_vec2);
+	rkrd_values_quat(values, rkrd_field_main_rot, &physics->main_rot);
+	rkrd_values_quat(values, rkrd_field_full_rot, &physics->full_rot);
+}
+
+/* bitwise, so -0 and 0 or differing NaNs are a desync */
+bool rkrd_values_equal(const rkrd_values_t* a, const rkrd_values_t* b, int field)
+{
+	return !memcmp(a->values[field], b->values[field], sizeof(a->values[field]));
+}
+
+/* one bit per field in field_mask whose row differs in any bit, stopping at the first one with early_exit */
+uint32_t rkrd_values_mismatch(const rkrd_values_t* a, const rkrd_values_t* b, uint32_t field_mask, bool early_exit)
+{
+	uint32_t mask = 0;
+	for (int field = 0; field < rkrd_field_max; field++)
+	{
+		if (!(field_mask & (1u << field)))
+			continue;
+
+		__m128i x = _mm_loadu_si128((const __m128i*)a->values[field]);
+		__m128i y = _mm_loadu_si128((const __m128i*)b->values[field]);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(x, y)) != 0xFFFF)
+		{
+			mask |= 1u << field;
+			if (early_exit)
+				break;
+		}
+	}
+	return mask;
+}
+
+/* the default, exact and stopping at the first desync with every mismatching field reported */
+void rkrd_check_init(rkrd_check_t* check)
+{
+	check->field_mask = RKRD_FIELDS_ALL;
+	check->max_ulps	  = 0;
+	check->stop		  = true;
+	check->early_exit = false;
+}
+
+/*
+	strict-stop       stop at the first mismatching field of the first desync
+	strict-continue   keep simulating and count every desynced frame
+	ulp:<n>           floats within n units in the last place match
+	fields:<a,b,...>  only compare these fields
+	policies combine when given one after another
+*/
+int rkrd_check_parse(rkrd_check_t* check, const char* policy)
+{
+	if (!strcmp(policy, "strict-stop"))
+	{
+		check->stop = true;
+		check->early_exit = true;
+		return 1;
+	}
+
+	if (!strcmp(policy, "strict-continue"))
+	{
+		check->stop = false;
+		check->early_exit = false;
+		return 1;
+	}
+
+	if (!strncmp(policy, "ulp:", 4))
+	{
+		char* end;
+		unsigned long ulps = strtoul(policy + 4, &end, 10);
+		if (end == policy + 4 || *end)
+			return 0;
+
+		check->max_ulps = (uint32_t)ulps;
+		return 1;
+	}
+
+	if (!strncmp(policy, "fields:", 7))
+	{
+		uint32_t mask = 0;
+		const char* name = policy + 7;
+
+		while (*name)
+		{
+			size_t len = strcspn(name, ",");
+			int field = 0;
+			for (; field < rkrd_field_max; field++)
+			{
+				if (strlen(rkrd_field_names[field]) == len && !strncmp(name, rkrd_field_names[field], len))
+					break;
+			}
+
+			if (field == rkrd_field_max)
+				return 0;
+
+			mask |= 1u << field;
+			name += len;
+			if (*name == ',')
+				name++;
+		}
+
+		if (!mask)
+			return 0;
+
+		check->field_mask = mask;
+		return 1;
+	}
+
+	return 0;
+}
+
+/* maps float bits onto a line where neighbouring floats are 1 apart, -0 and 0 included */
+int64_t rkrd_float_ordered(float value)
+{
+	float_bits bits = { .val = value };
+	int32_t i = (int32_t)bits.bits;
+	return i < 0 ? (int64_t)INT32_MIN - i : i;
+}
+
+bool rkrd_values_close(const rkrd_values_t* a, const rkrd_values_t* b, int field, uint32_t max_ulps)
+{
+	if (max_ulps == 0)
+		return rkrd_values_equal(a, b, field);
+
+	for (int i = 0; i < rkrd_field_sizes[field]; i++)
+	{
+		float x = a->values[field][i];
+		float y = b->values[field][i];
+		if (isnan(x) || isnan(y))
+			return false;
+
+		int64_t diff = rkrd_float_ordered(x) - rkrd_float_ordered(y);
+		if (diff < -(int64_t)max_ulps || diff > (int64_t)max_ulps)
+			return false;
+	}
+	return true;
+}
+
+bool rkrd_check_desync(const rkrd_values_t* expected, physics_t* physics, const rkrd_check_t* check, rkrd_desync_t* desync)
 {
-	bool ret = true;
+	rkrd_values_t actual;
+	rkrd_values_physics(&actual, physics);
 
-	#define check_float(actual, expected) \
-	if (actual != expected) \
-	{ \
-		printf("Desync: " #actual " %.12f, expected %.12f\n", \
-			actual, expected); \
-		ret = false;\
+	uint32_t mask;
+	if (check->max_ulps == 0)
+	{
+		mask = rkrd_values_mismatch(&actual, expected, check->field_mask, check->early_exit);
 	}
-	#define check_vec3(actual, expected) \
-	if (actual.x != expected.x || actual.y != expected.y || actual.z != expected.z) \
-	{ \
-		printf("Desync: " #actual " %.12f %.12f %.12f, expected %.12f %.12f %.12f\n", \
-			actual.x, actual.y, actual.z, \
-			expected.x, expected.y, expected.z); \
-		ret = false;\
+	else
+	{
+		mask = 0;
+		for (int field = 0; field < rkrd_field_max; field++)
+		{
+			if ((check->field_mask & (1u << field)) && !rkrd_values_close(&actual, expected, field, check->max_ulps))
+			{
+				mask |= 1u << field;
+				if (check->early_exit)
+					break;
+			}
+		}
 	}
-	#define check_quat(actual, expected) \
-	if (actual.x != expected.x || actual.y != expected.y || actual.z != expected.z || actual.w != expected.w) \
-	{ \
-		printf("Desync: " #actual " %.12f %.12f %.12f %.12f, expected %.12f %.12f %.12f %.12f\n", \
-			actual.x, actual.y, actual.z, actual.w, \
-			expected.x, expected.y, expected.z, expected.w); \
-		ret = false;\
+
+	if (!mask)
+		return true;
+
+	desync->field_mask = mask;
+	desync->actual = actual;
+	desync->expected = *expected;
+	return false;
+}
+
+/* keeps the first desync and, when not stopping there, how every field diverged afterwards */
+void rkrd_check_frame(rkrd_t* rkrd, uint32_t frame_idx, physics_t* physics, const rkrd_check_t* check)
+{
+	if (frame_idx >= rkrd->frame_count)
+		return;
+
+	if (rkrd->frame_desync != UINT32_MAX && check->stop)
+		return;
+
+	rkrd_values_t* expected = rkrd_frame(rkrd, frame_idx);
+	if (!expected)
+		return;
+
+	rkrd_desync_t desync;
+	if (rkrd_check_desync(expected, physics, check, &desync))
+		return;
+
+	if (rkrd->frame_desync == UINT32_MAX)
+	{
+		rkrd->frame_desync = frame_idx;
+		rkrd->desync = desync;
 	}
 
-	check_vec3(physics->up,       frame->floor_nor);
-	check_vec3(physics->dir,      frame->dir);
-	check_vec3(physics->pos,      frame->pos);
-	check_vec3(physics->vel0,     frame->vel0);
-	check_float(physics->speed1,  frame->speed1);
-	check_vec3(physics->vel,      frame->vel);
-	check_vec3(physics->rot_vec0, frame->rot_vec0);
-	check_vec3(physics->rot_vec2, frame->rot_vec2);
-	check_quat(physics->main_rot, frame->main_rot);
-	check_quat(physics->full_rot, frame->full_rot);
+	rkrd_stats_t* stats = &rkrd->stats;
+	stats->desync_frames++;
 
-	#undef check_float
-	#undef check_vec3
-	#undef check_quat
+	for (int field = 0; field < rkrd_field_max; field++)
+	{
+		if (!(desync.field_mask & (1u << field)))
+			continue;
 
-	return ret;
+		rkrd_field_stats_t* field_stats = &stats->fields[field];
+		if (field_stats->frames == 0 || field_stats->last + 1 != frame_idx)
+		{
+			field_stats->spans++;
+			field_stats->current = 0;
+		}
+
+		if (field_stats->frames == 0)
+			field_stats->first = frame_idx;
+
+		field_stats->frames++;
+		field_stats->last = frame_idx;
+		field_stats->current++;
+		field_stats->longest = max(field_stats->longest, field_stats->current);
+	}
+}
+
+void rkrd_print_desync(rkrd_desync_t* desync, strbuf_t* output)
+{
+	for (int field = 0; field < rkrd_field_max; field++)
+	{
+		if (!(desync->field_mask & (1u << field)))
+			continue;
+
+		float* actual = desync->actual.values[field];
+		float* expected = desync->expected.values[field];
+		int size = rkrd_field_sizes[field];
+
+		strbuf_printf(output, "Desync: physics->%s", rkrd_field_names[field]);
+		for (int i = 0; i < size; i++)
+			strbuf_printf(output, " %.12f", actual[i]);
+		strbuf_printf(output, ", expected");
+		for (int i = 0; i < size; i++)
+			strbuf_printf(output, " %.12f", expected[i]);
+		strbuf_printf(output, "\n");
+	}
+}
+
+/* one line per field that ever diverged */
+void rkrd_print_stats(rkrd_stats_t* stats, strbuf_t* output)
+{
+	strbuf_printf(output, "Desynced frames: %u\n", stats->desync_frames);
+
+	for (int field = 0; field < rkrd_field_max; field++)
+	{
+		rkrd_field_stats_t* field_stats = &stats->fields[field];
+		if (field_stats->frames == 0)
+			continue;
+
+		strbuf_printf(output, "  %-8s %u frames in %u span(s), first %u, last %u, longest %u\n",
+			rkrd_field_names[field], field_stats->frames, field_stats->spans,
+			field_stats->first, field_stats->last, field_stats->longest);
+	}
 }
 
 parser_t rkrd_parser =
 {
-    rkrd_init,
-    rkrd_free,
-    rkrd_parse,
+    (parser_init_t)rkrd_init,
+    (parser_free_t)rkrd_free,
+    (parser_parse_t)rkrd_parse,
 };
\ No newline at end of file
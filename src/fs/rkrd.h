@@ -2,7 +2,7 @@
 
 typedef struct physics_t physics_t;
 
-typedef struct 
+typedef struct rkrd_frame_t
 {
 	vec3_t			rot_vec2;
 	float			speed1_soft_limit;
@@ -26,13 +26,99 @@ typedef struct
 	uint32_t		version;
 } rkrd_header_t;
 
+/* every physics field the keyframes are checked against */
+enum
+{
+	rkrd_field_up,
+	rkrd_field_dir,
+	rkrd_field_pos,
+	rkrd_field_vel0,
+	rkrd_field_speed1,
+	rkrd_field_vel,
+	rkrd_field_rot_vec0,
+	rkrd_field_rot_vec2,
+	rkrd_field_main_rot,
+	rkrd_field_full_rot,
+
+	rkrd_field_max
+};
+
+extern const char* rkrd_field_names[rkrd_field_max];
+extern const int   rkrd_field_sizes[rkrd_field_max];
+
+/* one 16 byte row per field, unused lanes are zero so whole rows compare bitwise */
+typedef struct rkrd_values_t
+{
+	float			values[rkrd_field_max][4];
+} rkrd_values_t;
+
+void	 rkrd_values_frame(rkrd_values_t* values, rkrd_frame_t* frame);
+void	 rkrd_values_physics(rkrd_values_t* values, physics_t* physics);
+bool	 rkrd_values_equal(const rkrd_values_t* a, const rkrd_values_t* b, int field);
+uint32_t rkrd_values_mismatch(const rkrd_values_t* a, const rkrd_values_t* b, uint32_t field_mask, bool early_exit);
+
+/* what was wrong on the first desynced frame */
+typedef struct rkrd_desync_t
+{
+	uint32_t		field_mask;
+	rkrd_values_t	actual;
+	rkrd_values_t	expected;
+} rkrd_desync_t;
+
+#define RKRD_FIELDS_ALL ((1u << rkrd_field_max) - 1)
+
+/* how frames are compared against the keyframes, and what happens on a mismatch */
+typedef struct rkrd_check_t
+{
+	uint32_t		field_mask;		/* fields compared, the rest are ignored */
+	uint32_t		max_ulps;		/* 0 compares exactly */
+	bool			stop;			/* stop simulating at the first desync, otherwise count them */
+	bool			early_exit;		/* only report the first mismatching field of a frame */
+} rkrd_check_t;
+
+void rkrd_check_init(rkrd_check_t* check);
+int  rkrd_check_parse(rkrd_check_t* check, const char* policy);
+
+/* mismatches of one field while simulating past the first desync */
+typedef struct rkrd_field_stats_t
+{
+	uint32_t		frames;
+	uint32_t		spans;
+	uint32_t		first;
+	uint32_t		last;
+	uint32_t		longest;
+	uint32_t		current;
+} rkrd_field_stats_t;
+
+typedef struct rkrd_stats_t
+{
+	uint32_t			desync_frames;
+	rkrd_field_stats_t	fields[rkrd_field_max];
+} rkrd_stats_t;
+
+#define RKRD_CHUNK_FRAMES 256
+
+/* frames stay in the file and are unpacked into frames one chunk at a time */
 typedef struct rkrd_t
 {
-	rkrd_frame_t*	frames;
+	bin_t			file;
+	bool			mapped;
+	bool			compact;		/* an .rkrz from rkrz_write */
+	rkrd_values_t*	frames;			/* RKRD_CHUNK_FRAMES packed frames, compared against rkrd_values_physics */
+	uint32_t		chunk_start;
+	bool			damaged;		/* a chunk failed to decode, checking stopped there */
 	uint32_t		frame_count;
 	uint32_t		frame_desync;
+	rkrd_desync_t	desync;
+	rkrd_stats_t	stats;
 } rkrd_t;
 
-bool rkrd_check_desync(rkrd_frame_t* frame, physics_t* physics);
+int			   rkrd_open(rkrd_t* rkrd, const char* filename);
+rkrd_values_t* rkrd_frame(rkrd_t* rkrd, uint32_t frame_idx);
+
+bool rkrd_check_desync(const rkrd_values_t* expected, physics_t* physics, const rkrd_check_t* check, rkrd_desync_t* desync);
+void rkrd_check_frame(rkrd_t* rkrd, uint32_t frame_idx, physics_t* physics, const rkrd_check_t* check);
+void rkrd_print_desync(rkrd_desync_t* desync, strbuf_t* output);
+void rkrd_print_stats(rkrd_stats_t* stats, strbuf_t* output);
 
 extern parser_t rkrd_parser;
\ No newline at end of file
@@ -0,0 +1,554 @@
+#include "../common.h"
+#include "rkrd.h"
+#include "rkrz.h"
+
+static const char rkrz_id[4] = { 'R', 'K', 'R', 'Z' };
+
+#define RKRZ_LANES 30
+
+/* one float per compared component, the zero padding of rkrd_values_t is skipped */
+typedef struct
+{
+	uint32_t	prev[RKRZ_LANES];
+	uint32_t	prev2[RKRZ_LANES];
+	uint8_t		slots[RKRZ_LANES];	/* where each lane is in rkrd_values_t values */
+} rkrz_lanes_t;
+
+/* a symbol is the bit length of a predicted XOR, 0 to 32 */
+#define RKRZ_SYMBOLS 33
+#define RKRZ_MAX_CODE 12
+
+/* worst case: the code lengths, then every float as a longest code and 31 bits */
+#define RKRZ_BLOCK_MAX_SIZE ((RKRZ_SYMBOLS * 4 + rkrz_block_frames * RKRZ_LANES * (RKRZ_MAX_CODE + 31)) / 8 + 8)
+
+typedef struct
+{
+	uint8_t*	data;
+	size_t		size;
+	uint64_t	bits;
+	uint32_t	count;
+} rkrz_writer_t;
+
+void rkrz_write_bits(rkrz_writer_t* writer, uint32_t value, uint32_t count)
+{
+	writer->bits = (writer->bits << count) | value;
+	writer->count += count;
+	while (writer->count >= 8)
+	{
+		writer->count -= 8;
+		writer->data[writer->size++] = (uint8_t)(writer->bits >> writer->count);
+	}
+}
+
+void rkrz_write_flush(rkrz_writer_t* writer)
+{
+	if (writer->count > 0)
+		rkrz_write_bits(writer, 0, 8 - writer->count);
+}
+
+typedef struct
+{
+	const uint8_t*	data;
+	size_t			size;
+	size_t			bit;
+} rkrz_reader_t;
+
+/*
+	the next 57 or more bits, most significant first. past the end of the block
+	reads as zeros, rkrz_decode_block then sees it went too far
+*/
+uint64_t rkrz_peek_bits(rkrz_reader_t* reader)
+{
+	size_t byte = reader->bit >> 3;
+	uint64_t word = 0;
+
+	if (byte + 8 <= reader->size)
+	{
+		uint32_t hi, lo;
+		memcpy(&hi, reader->data + byte, sizeof(hi));
+		memcpy(&lo, reader->data + byte + 4, sizeof(lo));
+		word = ((uint64_t)bswap_uint32(hi) << 32) | bswap_uint32(lo);
+	}
+	else
+	{
+		for (size_t i = byte; i < byte + 8; i++)
+			word = (word << 8) | (i < reader->size ? reader->data[i] : 0);
+	}
+
+	return word << (reader->bit & 7);
+}
+
+uint32_t rkrz_bit_length(uint32_t value)
+{
+	uint32_t length = 0;
+	while (value)
+	{
+		value >>= 1;
+		length++;
+	}
+	return length;
+}
+
+void rkrz_lanes_init(rkrz_lanes_t* lanes)
+{
+	memset(lanes->prev, 0, sizeof(lanes->prev));
+	memset(lanes->prev2, 0, sizeof(lanes->prev2));
+
+	int lane = 0;
+	for (int field = 0; field < rkrd_field_max; field++)
+	{
+		for (int j = 0; j < rkrd_field_sizes[field]; j++)
+			lanes->slots[lane++] = (uint8_t)(field * 4 + j);
+	}
+}
+
+/*
+	the float continued in a straight line from the last two frames, in the
+	integer order of its bits. the first frame of a block predicts zero and the
+	second repeats the first, see rkrz_lanes_started
+*/
+uint32_t rkrz_predict(rkrz_lanes_t* lanes, int lane)
+{
+	return lanes->prev[lane] + (lanes->prev[lane] - lanes->prev2[lane]);
+}
+
+void rkrz_lanes_push(rkrz_lanes_t* lanes, int lane, uint32_t value)
+{
+	lanes->prev2[lane] = lanes->prev[lane];
+	lanes->prev[lane] = value;
+}
+
+/* after the first frame of a block, so the second one has no slope yet */
+void rkrz_lanes_started(rkrz_lanes_t* lanes)
+{
+	memcpy(lanes->prev2, lanes->prev, sizeof(lanes->prev2));
+}
+
+/*
+	Huffman code lengths of a block's symbols. codes longer than RKRZ_MAX_CODE
+	are avoided by halving the counts until the tree is shallow enough
+*/
+void rkrz_code_lengths(const uint32_t* symbol_counts, uint8_t* lengths)
+{
+	uint32_t counts[RKRZ_SYMBOLS];
+	memcpy(counts, symbol_counts, sizeof(counts));
+
+	for (;;)
+	{
+		uint32_t weights[RKRZ_SYMBOLS * 2];
+		int parents[RKRZ_SYMBOLS * 2];
+		bool active[RKRZ_SYMBOLS * 2];
+		int node_count = RKRZ_SYMBOLS;
+		int used = 0;
+
+		for (int i = 0; i < RKRZ_SYMBOLS; i++)
+		{
+			weights[i] = counts[i];
+			parents[i] = -1;
+			active[i] = counts[i] > 0;
+			used += active[i];
+		}
+
+		memset(lengths, 0, RKRZ_SYMBOLS);
+		if (used == 1)
+		{
+			for (int i = 0; i < RKRZ_SYMBOLS; i++)
+				lengths[i] = counts[i] > 0;
+			return;
+		}
+
+		for (int merges = 0; merges < used - 1; merges++)
+		{
+			int a = -1, b = -1;
+			for (int i = 0; i < node_count; i++)
+			{
+				if (!active[i])
+					continue;
+				if (a < 0 || weights[i] < weights[a])
+				{
+					b = a;
+					a = i;
+				}
+				else if (b < 0 || weights[i] < weights[b])
+				{
+					b = i;
+				}
+			}
+
+			weights[node_count] = weights[a] + weights[b];
+			parents[node_count] = -1;
+			active[node_count] = true;
+			parents[a] = parents[b] = node_count;
+			active[a] = active[b] = false;
+			node_count++;
+		}
+
+		uint32_t longest = 0;
+		for (int i = 0; i < RKRZ_SYMBOLS; i++)
+		{
+			if (!counts[i])
+				continue;
+
+			uint32_t depth = 0;
+			for (int node = i; parents[node] >= 0; node = parents[node])
+				depth++;
+			lengths[i] = (uint8_t)depth;
+			longest = max(longest, depth);
+		}
+
+		if (longest <= RKRZ_MAX_CODE)
+			return;
+
+		for (int i = 0; i < RKRZ_SYMBOLS; i++)
+			counts[i] = counts[i] ? (counts[i] + 1) / 2 : 0;
+	}
+}
+
+/* canonical codes, shorter first and by symbol within a length, so only the lengths are stored */
+int rkrz_canonical_codes(const uint8_t* lengths, uint32_t* codes)
+{
+	uint32_t code = 0;
+	uint32_t space = 0;
+	for (uint32_t length = 1; length <= RKRZ_MAX_CODE; length++)
+	{
+		for (int i = 0; i < RKRZ_SYMBOLS; i++)
+		{
+			if (lengths[i] != length)
+				continue;
+
+			codes[i] = code++;
+			space += 1u << (RKRZ_MAX_CODE - length);
+		}
+		code <<= 1;
+	}
+
+	/* a damaged block can claim more codes than fit */
+	return space <= (1u << RKRZ_MAX_CODE);
+}
+
+uint32_t* rkrz_header_offsets(bin_t* rkrz_buffer)
+{
+	return (uint32_t*)(rkrz_buffer->buffer + sizeof(rkrz_header_t));
+}
+
+int rkrz_parse_header(rkrd_t* rkrd, bin_t* rkrz_buffer)
+{
+	rkrz_header_t* header = (rkrz_header_t*)rkrz_buffer->buffer;
+	if (rkrz_buffer->size < sizeof(rkrz_header_t)
+		|| strncmp(header->id.cc, rkrz_id, sizeof(rkrz_id))
+		|| header->version != rkrz_version)
+	{
+		printf("Error reading RKRZ, bad header or written by another version\n");
+		return 0;
+	}
+
+	uint32_t block_count = (header->frame_count + rkrz_block_frames - 1) / rkrz_block_frames;
+	size_t index_end = sizeof(rkrz_header_t) + ((size_t)block_count + 1) * sizeof(uint32_t);
+	if (header->block_count != block_count || rkrz_buffer->size < index_end)
+	{
+		printf("Error reading RKRZ, bad block index\n");
+		return 0;
+	}
+
+	uint32_t* offsets = rkrz_header_offsets(rkrz_buffer);
+	for (uint32_t i = 0; i <= block_count; i++)
+	{
+		if (offsets[i] < index_end || offsets[i] > rkrz_buffer->size || (i > 0 && offsets[i] < offsets[i - 1]))
+		{
+			printf("Error reading RKRZ, bad block index\n");
+			return 0;
+		}
+	}
+
+	rkrd->frame_count = header->frame_count;
+	return 1;
+}
+
+int rkrz_block_range(bin_t* rkrz_buffer, uint32_t block, size_t* offset, size_t* size)
+{
+	rkrz_header_t* header = (rkrz_header_t*)rkrz_buffer->buffer;
+	if (block >= header->block_count)
+		return 0;
+
+	uint32_t* offsets = rkrz_header_offsets(rkrz_buffer);
+	*offset = offsets[block];
+	*size = offsets[block + 1] - offsets[block];
+	return 1;
+}
+
+/* fails on a block missing from the index, a bad code or one that runs out of bits before its last frame */
+int rkrz_decode_block(bin_t* rkrz_buffer, uint32_t block, rkrd_values_t* frames, uint32_t count)
+{
+	size_t offset, size;
+	if (!rkrz_block_range(rkrz_buffer, block, &offset, &size))
+		return 0;
+
+	rkrz_reader_t reader = { rkrz_buffer->buffer + offset, size, 0 };
+
+	uint8_t lengths[RKRZ_SYMBOLS];
+	for (int i = 0; i < RKRZ_SYMBOLS; i++)
+	{
+		lengths[i] = (uint8_t)(rkrz_peek_bits(&reader) >> 60);
+		reader.bit += 4;
+		if (lengths[i] > RKRZ_MAX_CODE)
+			return 0;
+	}
+
+	uint32_t codes[RKRZ_SYMBOLS];
+	if (!rkrz_canonical_codes(lengths, codes))
+		return 0;
+
+	/* symbol and code length by the next RKRZ_MAX_CODE bits, zero where no code starts */
+	uint16_t table[1 << RKRZ_MAX_CODE];
+	memset(table, 0, sizeof(table));
+	for (int i = 0; i < RKRZ_SYMBOLS; i++)
+	{
+		if (!lengths[i])
+			continue;
+
+		uint32_t first = codes[i] << (RKRZ_MAX_CODE - lengths[i]);
+		uint32_t span = 1u << (RKRZ_MAX_CODE - lengths[i]);
+		for (uint32_t j = 0; j < span; j++)
+			table[first + j] = (uint16_t)(lengths[i] << 8 | i);
+	}
+
+	rkrz_lanes_t lanes;
+	rkrz_lanes_init(&lanes);
+
+	/* a float takes at most a longest code and 31 bits, so refill below that */
+	uint64_t word = 0;
+	uint32_t available = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		float* values = frames[i].values[0];
+		memset(values, 0, sizeof(frames[i]));
+
+		for (int lane = 0; lane < RKRZ_LANES; lane++)
+		{
+			if (available < RKRZ_MAX_CODE + 31)
+			{
+				word = rkrz_peek_bits(&reader);
+				available = 64 - (uint32_t)(reader.bit & 7);
+			}
+
+			uint16_t entry = table[word >> (64 - RKRZ_MAX_CODE)];
+			if (!entry)
+				return 0;
+
+			uint32_t code_length = entry >> 8;
+			uint32_t length = entry & 0xFF;
+			uint32_t delta = length;
+			if (length > 1)
+			{
+				delta = (1u << (length - 1)) | (uint32_t)((word << code_length) >> (64 - (length - 1)));
+				code_length += length - 1;
+			}
+			reader.bit += code_length;
+			word <<= code_length;
+			available -= code_length;
+
+			float_bits bits = { .bits = delta ^ rkrz_predict(&lanes, lane) };
+			rkrz_lanes_push(&lanes, lane, bits.bits);
+			values[lanes.slots[lane]] = bits.val;
+		}
+
+		if (i == 0)
+			rkrz_lanes_started(&lanes);
+	}
+
+	return reader.bit <= size * 8;
+}
+
+/* an .rkrz without its .rkrd beside it is still fine to use */
+int rkrz_check_source(bin_t* rkrz_buffer, const char* filename, const char* source_path)
+{
+	uint64_t source_size, source_mtime;
+	if (!bin_stat(source_path, &source_size, &source_mtime))
+		return 1;
+
+	rkrz_header_t* header = (rkrz_header_t*)rkrz_buffer->buffer;
+	if (header->source_size != source_size || header->source_mtime != source_mtime)
+	{
+		printf("Ignoring %s, %s changed since it was packed\n", filename, source_path);
+		return 0;
+	}
+	return 1;
+}
+
+int rkrz_write(rkrd_t* rkrd, const char* filename, const char* source_path)
+{
+	uint64_t source_size, source_mtime;
+	if (!bin_stat(source_path, &source_size, &source_mtime))
+	{
+		printf("Couldn't stat %s\n", source_path);
+		return 0;
+	}
+
+	char temp_filename[_MAX_PATH];
+	snprintf(temp_filename, sizeof(temp_filename), "%s.tmp", filename);
+
+	FILE* file = fopen(temp_filename, "wb");
+	if (!file)
+	{
+		printf("Failed to open %s for writing\n", temp_filename);
+		return 0;
+	}
+
+	rkrz_header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.id.cc, rkrz_id, sizeof(rkrz_id));
+	header.version = rkrz_version;
+	header.frame_count = rkrd->frame_count;
+	header.block_count = (rkrd->frame_count + rkrz_block_frames - 1) / rkrz_block_frames;
+	header.source_size = source_size;
+	header.source_mtime = source_mtime;
+
+	size_t index_size = ((size_t)header.block_count + 1) * sizeof(uint32_t);
+	uint32_t* offsets = calloc(header.block_count + 1, sizeof(uint32_t));
+	rkrz_writer_t writer = { malloc(RKRZ_BLOCK_MAX_SIZE), 0, 0, 0 };
+
+	uint32_t offset = (uint32_t)(sizeof(header) + index_size);
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+		&& fwrite(offsets, 1, index_size, file) == index_size;
+
+	/* each block is predicted once to count its symbols, then written with a code built for them */
+	uint32_t* deltas = malloc(rkrz_block_frames * RKRZ_LANES * sizeof(uint32_t));
+
+	for (uint32_t block = 0; block < header.block_count && ok; block++)
+	{
+		rkrz_lanes_t lanes;
+		rkrz_lanes_init(&lanes);
+
+		uint32_t symbol_counts[RKRZ_SYMBOLS];
+		memset(symbol_counts, 0, sizeof(symbol_counts));
+
+		uint32_t first = block * rkrz_block_frames;
+		uint32_t count = min(rkrz_block_frames, rkrd->frame_count - first);
+		uint32_t delta_count = 0;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			rkrd_values_t* values = rkrd_frame(rkrd, first + i);
+			if (!values)
+			{
+				ok = false;
+				break;
+			}
+
+			for (int lane = 0; lane < RKRZ_LANES; lane++)
+			{
+				float_bits bits = { .val = values->values[0][lanes.slots[lane]] };
+				uint32_t delta = bits.bits ^ rkrz_predict(&lanes, lane);
+				rkrz_lanes_push(&lanes, lane, bits.bits);
+
+				deltas[delta_count++] = delta;
+				symbol_counts[rkrz_bit_length(delta)]++;
+			}
+
+			if (i == 0)
+				rkrz_lanes_started(&lanes);
+		}
+
+		if (!ok)
+			break;
+
+		uint8_t lengths[RKRZ_SYMBOLS];
+		uint32_t codes[RKRZ_SYMBOLS];
+		rkrz_code_lengths(symbol_counts, lengths);
+		rkrz_canonical_codes(lengths, codes);
+
+		writer.size = 0;
+		for (int i = 0; i < RKRZ_SYMBOLS; i++)
+			rkrz_write_bits(&writer, lengths[i], 4);
+
+		for (uint32_t i = 0; i < delta_count; i++)
+		{
+			uint32_t delta = deltas[i];
+			uint32_t length = rkrz_bit_length(delta);
+			rkrz_write_bits(&writer, codes[length], lengths[length]);
+			if (length > 1)
+				rkrz_write_bits(&writer, delta & ((1u << (length - 1)) - 1), length - 1);
+		}
+
+		rkrz_write_flush(&writer);
+		offsets[block] = offset;
+		ok = fwrite(writer.data, 1, writer.size, file) == writer.size;
+		offset += (uint32_t)writer.size;
+	}
+
+	free(deltas);
+
+	offsets[header.block_count] = offset;
+	ok = ok && fseek(file, sizeof(header), SEEK_SET) == 0
+		&& fwrite(offsets, 1, index_size, file) == index_size;
+	ok = (fclose(file) == 0) && ok;
+
+	free(writer.data);
+	free(offsets);
+
+	if (!ok)
+	{
+		printf("Failed to write %s\n", temp_filename);
+		remove(temp_filename);
+		return 0;
+	}
+
+	remove(filename);
+	if (rename(temp_filename, filename) != 0)
+	{
+		printf("Failed to move %s to %s\n", temp_filename, filename);
+		remove(temp_filename);
+		return 0;
+	}
+
+	return 1;
+}
+
+/* packs an .rkrd beside itself, then reads the result back and checks every frame bit for bit */
+int rkrz_build(const char* rkrd_path)
+{
+	char rkrz_path[_MAX_PATH];
+	strext(rkrz_path, rkrd_path, "rkrz");
+
+	rkrd_t rkrd, rkrz;
+	if (!rkrd_open(&rkrd, rkrd_path))
+		return 0;
+
+	int ret = 0;
+	rkrd_parser.init(&rkrz);
+
+	if (!rkrz_write(&rkrd, rkrz_path, rkrd_path) || !rkrd_open(&rkrz, rkrz_path))
+		goto cleanup;
+
+	if (rkrz.frame_count != rkrd.frame_count)
+	{
+		printf("Packed %s has %u frames, expected %u\n", rkrz_path, rkrz.frame_count, rkrd.frame_count);
+		goto cleanup;
+	}
+
+	for (uint32_t i = 0; i < rkrd.frame_count; i++)
+	{
+		rkrd_values_t* expected = rkrd_frame(&rkrd, i);
+		rkrd_values_t* packed = rkrd_frame(&rkrz, i);
+		if (!expected || !packed)
+		{
+			printf("Couldn't read frame %u of %s back\n", i, !expected ? rkrd_path : rkrz_path);
+			goto cleanup;
+		}
+
+		if (rkrd_values_mismatch(expected, packed, RKRD_FIELDS_ALL, true))
+		{
+			printf("Packed %s differs from the original on frame %u\n", rkrz_path, i);
+			goto cleanup;
+		}
+	}
+
+	printf("Packed %s, %zu -> %zu bytes\n", rkrd_path, rkrd.file.size, rkrz.file.size);
+	ret = 1;
+
+cleanup:
+	rkrd_parser.free(&rkrz);
+	rkrd_parser.free(&rkrd);
+	if (!ret)
+		remove(rkrz_path);
+	return ret;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+/*
+* Compact keyframes, written by -pack-traces beside the .rkrd they came from.
+* Only the compared fields are kept. Every float's bits are XORed with where the
+* last two frames say it should be, and the bit length of that difference is
+* Huffman coded, followed by the bits below its leading one. An unchanged or
+* steadily changing float costs a short code. Blocks of rkrz_block_frames carry
+* their own code and start from zero again, so the index can jump to any block
+* and decode it alone. Decoding takes longer than reading the .rkrd, so the
+* .rkrd is preferred while it exists and the .rkrz is for storing traces
+*/
+enum
+{
+	rkrz_version = 3,
+	rkrz_block_frames = RKRD_CHUNK_FRAMES,
+};
+
+typedef struct
+{
+	id_t		id;
+	uint32_t	version;
+	uint32_t	frame_count;
+	uint32_t	block_count;
+	uint64_t	source_size;	/* of the .rkrd it was packed from, a changed one makes this stale */
+	uint64_t	source_mtime;
+	/* followed by block_count + 1 file offsets, the last one is the end of the data */
+} rkrz_header_t;
+
+int  rkrz_parse_header(rkrd_t* rkrd, bin_t* rkrz_buffer);
+int  rkrz_block_range(bin_t* rkrz_buffer, uint32_t block, size_t* offset, size_t* size);
+int  rkrz_decode_block(bin_t* rkrz_buffer, uint32_t block, rkrd_values_t* frames, uint32_t count);
+
+int  rkrz_check_source(bin_t* rkrz_buffer, const char* filename, const char* source_path);
+int  rkrz_write(rkrd_t* rkrd, const char* filename, const char* source_path);
+int  rkrz_build(const char* rkrd_path);
@@ -3,11 +3,145 @@
 
 int yaz_is_compressed(bin_t* in)
 {
+    if (in->size < sizeof(yaz_header_t))
+        return 0;
+
     yaz_header_t* yaz_header = (yaz_header_t*)in->buffer;
     return !strncmp(yaz_header->id, "Yaz0", 4) || !(strncmp(yaz_header->id, "Yaz1", 4));
 }
 
+/*
+	copies a back-reference. far ones go 16 or 8 bytes at a time, which can write
+	up to 15 bytes past n, so that is only done with room left in the output.
+	near ones overlap themselves and repeat a short pattern
+*/
+void yaz_copy_match(uint8_t* dst, uint8_t* dst_end, size_t seekback, size_t n)
+{
+    const uint8_t* from = dst - seekback;
+
+    if (seekback >= 16 && (size_t)(dst_end - dst) >= n + 15)
+    {
+        for (size_t i = 0; i < n; i += 16)
+            memcpy(dst + i, from + i, 16);
+    }
+    else if (seekback >= 8 && (size_t)(dst_end - dst) >= n + 7)
+    {
+        for (size_t i = 0; i < n; i += 8)
+            memcpy(dst + i, from + i, 8);
+    }
+    else if (seekback == 1)
+    {
+        memset(dst, dst[-1], n);
+    }
+    else
+    {
+        for (size_t i = 0; i < n; i++)
+            dst[i] = from[i];
+    }
+}
+
 int yaz_decompress(bin_t* in, bin_t* out)
+{
+    bin_init(out);
+    if (in->size < sizeof(yaz_header_t))
+        return YAZ_INVALID_SIZE;
+    if (!yaz_is_compressed(in))
+        return YAZ_INVALID_HEADER;
+
+    yaz_header_t* yaz_header = (yaz_header_t*)in->buffer;
+    size_t decompressed_size = bswap_uint32(yaz_header->size_decompressed);
+    uint8_t* buffer = malloc(max(decompressed_size, 1));
+
+    const uint8_t* src = in->buffer + sizeof(yaz_header_t);
+    const uint8_t* src_end = in->buffer + in->size;
+    uint8_t* dst = buffer;
+    uint8_t* dst_end = buffer + decompressed_size;
+
+    while (dst < dst_end)
+    {
+        if (src >= src_end)
+            goto invalid;
+
+        uint8_t code_byte = *src++;
+
+        /* eight literals, the common case in poorly compressible data */
+        if (code_byte == 0xFF && src_end - src >= 8 && dst_end - dst >= 8)
+        {
+            memcpy(dst, src, 8);
+            dst += 8;
+            src += 8;
+            continue;
+        }
+
+        int i = 0;
+        while (i < 8 && dst < dst_end)
+        {
+            if (code_byte & (0x80 >> i))
+            {
+                if (!(code_byte & (0x40 >> i)))
+                {
+                    if (src >= src_end)
+                        goto invalid;
+
+                    *dst++ = *src++;
+                    i++;
+                    continue;
+                }
+
+                int run = 2;
+                while (i + run < 8 && (code_byte & (0x80 >> (i + run))))
+                    run++;
+
+                size_t count = min((size_t)run, (size_t)(dst_end - dst));
+                if ((size_t)(src_end - src) < count)
+                    goto invalid;
+
+                memcpy(dst, src, count);
+                dst += count;
+                src += count;
+                i += run;
+                continue;
+            }
+
+            if (src_end - src < 2)
+                goto invalid;
+
+            uint32_t encode = ((uint32_t)src[0] << 8) | src[1];
+            src += 2;
+
+            size_t seekback = (encode & 0x0FFF) + 1;
+            size_t n = encode >> 12;
+            if (n == 0)
+            {
+                if (src >= src_end)
+                    goto invalid;
+                n = (size_t)*src++ + 0x12;
+            }
+            else
+            {
+                n += 2;
+            }
+
+            if (seekback > (size_t)(dst - buffer))
+                goto invalid;
+
+            n = min(n, (size_t)(dst_end - dst));
+            yaz_copy_match(dst, dst_end, seekback, n);
+            dst += n;
+            i++;
+        }
+    }
+
+    bin_set(out, buffer, decompressed_size);
+    return YAZ_OK;
+
+invalid:
+    free(buffer);
+    return YAZ_INVALID_DATA;
+}
+
+/* the original byte at a time decoder, -bench-yaz checks against it and compares speed */
+int yaz_decompress_reference(bin_t* in, bin_t* out)
 {
     yaz_header_t* yaz_header = (yaz_header_t*)in->buffer;
     if (in->size < sizeof(yaz_header_t))
@@ -15,7 +149,7 @@ int yaz_decompress(bin_t* in, bin_t* out)
     if (!yaz_is_compressed(in))
         return YAZ_INVALID_HEADER;
 
-    size_t decompressed_size = bswap_int32(yaz_header->size_decompressed);
+    size_t decompressed_size = bswap_uint32(yaz_header->size_decompressed);
     out->size = decompressed_size;
     out->buffer = malloc(decompressed_size);
 
@@ -24,16 +158,16 @@ int yaz_decompress(bin_t* in, bin_t* out)
     size_t src_pos = 0;
     size_t dst_pos = 0;
 
-    while (dst_pos < decompressed_size) 
+    while (dst_pos < decompressed_size)
     {
         uint8_t code_byte = src[src_pos++];
-        for (int i = 0; i < 8 && dst_pos < decompressed_size; i++) 
+        for (int i = 0; i < 8 && dst_pos < decompressed_size; i++)
         {
-            if (code_byte & (0x80 >> i)) 
+            if (code_byte & (0x80 >> i))
             {
                 dst[dst_pos++] = src[src_pos++];
             }
-            else 
+            else
             {
                 uint16_t encode = bswap_uint16(*(uint16_t*)(src + src_pos));
                 src_pos += 2;
@@ -45,7 +179,7 @@ int yaz_decompress(bin_t* in, bin_t* out)
                 else
                     n += 2;
 
-                for (int j = 0; j < n && dst_pos < decompressed_size; j++) 
+                for (int j = 0; j < n && dst_pos < decompressed_size; j++)
                 {
                     dst[dst_pos] = dst[dst_pos - seekback];
                     dst_pos++;
@@ -55,4 +189,4 @@ int yaz_decompress(bin_t* in, bin_t* out)
     }
 
     return YAZ_OK;
-}
\ No newline at end of file
+}
@@ -5,6 +5,7 @@ enum
 	YAZ_OK = 0,
 	YAZ_INVALID_HEADER,
 	YAZ_INVALID_SIZE,
+	YAZ_INVALID_DATA,
 };
 
 typedef struct
@@ -15,4 +16,5 @@ typedef struct
 } yaz_header_t;
 
 int	yaz_is_compressed(bin_t* in);
-int yaz_decompress   (bin_t* in, bin_t* out);
\ No newline at end of file
+int yaz_decompress   (bin_t* in, bin_t* out);
+int yaz_decompress_reference(bin_t* in, bin_t* out);
\ No newline at end of file
@@ -0,0 +1,167 @@
+#include "../common.h"
+#include "../fs/rkrd.h"
+#include "../physics/physics.h"
+#include "diagnose.h"
+
+const char* diagnose_stage_names[diagnose_stage_max] =
+{
+	"start", "floor", "turn", "drift", "accel", "rotation", 
+	"physics", "body", "wheels", "suspension", "end",
+};
+
+void diagnose_init(diagnose_t* diagnose)
+{
+	memset(diagnose, 0, sizeof(*diagnose));
+}
+
+void diagnose_checkpoint(diagnose_t* diagnose, int stage, physics_t* physics)
+{
+	rkrd_values_physics(&diagnose->probes[stage], physics);
+	diagnose->stage_mask |= 1u << stage;
+}
+
+/* bitwise, so a NaN carried between checkpoints doesn't count as a change */
+bool diagnose_field_changed(rkrd_values_t* a, rkrd_values_t* b, int field)
+{
+	return memcmp(a->values[field], b->values[field], rkrd_field_sizes[field] * sizeof(float)) != 0;
+}
+
+/* largest error relative to the expected magnitude, at least 1 so small values compare absolutely */
+float diagnose_field_error(rkrd_values_t* actual, rkrd_values_t* expected, int field)
+{
+	float error = 0.0f;
+	for (int i = 0; i < rkrd_field_sizes[field]; i++)
+	{
+		float scale = fmaxf(fabsf(expected->values[field][i]), 1.0f);
+		float diff = fabsf(actual->values[field][i] - expected->values[field][i]) / scale;
+		if (isnan(diff))
+			return INFINITY;
+		error = fmaxf(error, diff);
+	}
+	return error;
+}
+
+/* last checkpoint that changed the field, the subsystem which produced its final value */
+int diagnose_field_writer(diagnose_t* diagnose, int field)
+{
+	int writer = diagnose_stage_start;
+	int last = diagnose_stage_start;
+
+	for (int stage = diagnose_stage_start + 1; stage < diagnose_stage_max; stage++)
+	{
+		if (!(diagnose->stage_mask & (1u << stage)))
+			continue;
+
+		if (diagnose_field_changed(&diagnose->probes[stage], &diagnose->probes[last], field))
+			writer = stage;
+		last = stage;
+	}
+
+	return writer;
+}
+
+/* JSON has no nan/inf */
+void diagnose_json_float(strbuf_t* output, float value)
+{
+	if (isfinite(value))
+		strbuf_printf(output, "%.9g", value);
+	else
+		strbuf_printf(output, "null");
+}
+
+void diagnose_json_values(strbuf_t* output, rkrd_values_t* probe, int field)
+{
+	strbuf_printf(output, "[");
+	for (int i = 0; i < rkrd_field_sizes[field]; i++)
+	{
+		if (i > 0)
+			strbuf_printf(output, ", ");
+		diagnose_json_float(output, probe->values[field][i]);
+	}
+	strbuf_printf(output, "]");
+}
+
+/*
+	one JSON object for the desynced frame. the culprit is the earliest stage
+	that wrote a wrong final value, preferring fields past the tolerance over
+	ones that are only off by rounding
+*/
+void diagnose_report(diagnose_t* diagnose, rkrd_values_t* expected, const char* ghost_path, uint32_t frame, strbuf_t* output)
+{
+	rkrd_values_t* actual = &diagnose->probes[diagnose_stage_end];
+
+	int writers[rkrd_field_max];
+	float errors[rkrd_field_max];
+	int culprit = diagnose_stage_max;
+	int rounding_culprit = diagnose_stage_max;
+
+	for (int field = 0; field < rkrd_field_max; field++)
+	{
+		writers[field] = -1;
+		if (rkrd_values_equal(actual, expected, field))
+			continue;
+
+		writers[field] = diagnose_field_writer(diagnose, field);
+		errors[field] = diagnose_field_error(actual, expected, field);
+
+		if (errors[field] > DIAGNOSE_TOLERANCE)
+			culprit = min(culprit, writers[field]);
+		else
+			rounding_culprit = min(rounding_culprit, writers[field]);
+	}
+
+	bool rounding = culprit == diagnose_stage_max;
+	if (rounding)
+		culprit = rounding_culprit;
+
+	strbuf_printf(output, "{\"ghost\": ");
+	strbuf_json_string(output, ghost_path);
+	strbuf_printf(output, ", \"frame\": %u, \"culprit\": \"%s\", \"rounding_only\": %s, \"tolerance\": %g, \"fields\": [",
+		frame, culprit < diagnose_stage_max ? diagnose_stage_names[culprit] : "none",
+		rounding ? "true" : "false", DIAGNOSE_TOLERANCE);
+
+	bool first = true;
+	for (int field = 0; field < rkrd_field_max; field++)
+	{
+		if (writers[field] < 0)
+			continue;
+
+		strbuf_printf(output, "%s{\"field\": \"%s\", \"stage\": \"%s\", \"error\": ",
+			first ? "" : ", ", rkrd_field_names[field], diagnose_stage_names[writers[field]]);
+		diagnose_json_float(output, errors[field]);
+		strbuf_printf(output, ", \"actual\": ");
+		diagnose_json_values(output, actual, field);
+		strbuf_printf(output, ", \"expected\": ");
+		diagnose_json_values(output, expected, field);
+		strbuf_printf(output, "}");
+		first = false;
+	}
+
+	strbuf_printf(output, "], \"checkpoints\": [");
+
+	first = true;
+	int last = diagnose_stage_start;
+	for (int stage = diagnose_stage_start + 1; stage < diagnose_stage_max; stage++)
+	{
+		if (!(diagnose->stage_mask & (1u << stage)))
+			continue;
+
+		strbuf_printf(output, "%s{\"stage\": \"%s\", \"changed\": [", first ? "" : ", ", diagnose_stage_names[stage]);
+
+		bool first_field = true;
+		for (int field = 0; field < rkrd_field_max; field++)
+		{
+			if (!diagnose_field_changed(&diagnose->probes[stage], &diagnose->probes[last], field))
+				continue;
+
+			strbuf_printf(output, "%s\"%s\"", first_field ? "" : ", ", rkrd_field_names[field]);
+			first_field = false;
+		}
+
+		strbuf_printf(output, "]}");
+		first = false;
+		last = stage;
+	}
+
+	strbuf_printf(output, "]}");
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "../fs/rkrd.h"
+
+/* checkpoints inside player_update, in the order they are reached */
+enum
+{
+	diagnose_stage_start,
+	diagnose_stage_floor,
+	diagnose_stage_turn,
+	diagnose_stage_drift,
+	diagnose_stage_accel,
+	diagnose_stage_rotation,
+	diagnose_stage_physics,
+	diagnose_stage_body,
+	diagnose_stage_wheels,
+	diagnose_stage_suspension,
+	diagnose_stage_end,
+
+	diagnose_stage_max
+};
+
+/* errors up to this, relative to the expected magnitude, count as rounding */
+#define DIAGNOSE_TOLERANCE 1e-5f
+
+/* keyframe fields as they were at each checkpoint */
+typedef struct diagnose_t
+{
+	rkrd_values_t		probes[diagnose_stage_max];
+	uint32_t			stage_mask;
+} diagnose_t;
+
+void diagnose_init(diagnose_t* diagnose);
+void diagnose_checkpoint(diagnose_t* diagnose, int stage, physics_t* physics);
+void diagnose_report(diagnose_t* diagnose, rkrd_values_t* expected, const char* ghost_path, uint32_t frame, strbuf_t* output);
+
+/* only the keyframed player is probed, the pointer is NULL otherwise */
+#define DIAGNOSE_CHECKPOINT(diagnose, stage, physics) \
+	do { if (diagnose) diagnose_checkpoint(diagnose, stage, physics); } while (0)
@@ -1,72 +1,113 @@
 #include "../common.h"
 #include "../vehicle/vehicle.h"
 #include "../course/course.h"
-#include "../graphics/graphics.h"
 #include "game.h"
 
-#include "SDL/SDL.h"
-
-void game_init(game_t* game)
+void game_data_init(game_data_t* data, int course_cache_size)
 {
-	arc_parser.init(&game->common);
-	course_parser.init(&game->course);
+	arc_parser.init(&data->common);
 
-	param_parser.init(&game->kartparam);
-	param_parser.init(&game->driverparam);
-	bikeparts_parser.init(&game->bikeparts);
+	param_parser.init(&data->kartparam);
+	param_parser.init(&data->driverparam);
+	bikeparts_parser.init(&data->bikeparts);
 
-	rkg_parser.init(&game->ghost);
-	rkrd_parser.init(&game->keyframes);
+	for (int i = 0; i < vehicle_max_id; i++)
+	{
+		bsp_parser.init(&data->bsps[i]);
+		data->bsp_found[i] = false;
+	}
+	data->stats = NULL;
+	data->stats_vehicles = 0;
+	data->stats_characters = 0;
 
-	game->players = NULL;
-	game->player_count = 0;
+	course_cache_init(&data->courses, course_cache_size);
+}
 
-	game->frame_idx = 0;
-	game->frame_delta = 0.0;
+void game_data_free(game_data_t* data)
+{
+	arc_parser.free(&data->common);
 
-	game->graphics = NULL;
+	param_parser.free(&data->kartparam);
+	param_parser.free(&data->driverparam);
+	bikeparts_parser.free(&data->bikeparts);
+	game_data_free_vehicles(data);
 
-	game->override_input = false;
-	game->pause = false;
-	game->step = false;
+	course_cache_free(&data->courses);
 }
 
-void game_free(game_t* game)
+void game_data_free_vehicles(game_data_t* data)
 {
-	arc_parser.free(&game->common);
-	course_parser.free(&game->course);
+	for (int i = 0; i < vehicle_max_id; i++)
+	{
+		bsp_parser.free(&data->bsps[i]);
+		data->bsp_found[i] = false;
+	}
 
-	param_parser.free(&game->kartparam);
-	param_parser.free(&game->driverparam);
-	bikeparts_parser.free(&game->bikeparts);
+	free(data->stats);
+	data->stats = NULL;
+	data->stats_vehicles = 0;
+	data->stats_characters = 0;
+}
 
-	rkg_parser.free(&game->ghost);
-	rkrd_parser.free(&game->keyframes);
+/*
+	parses every vehicle's bsp from Common.szs and merges the kart and driver
+	params of each pair. a missing bsp only fails the vehicles that need it
+*/
+int game_data_load_vehicles(game_data_t* data)
+{
+	for (uint8_t i = 0; i < vehicle_max_id; i++)
+	{
+		char bsp_name[_MAX_PATH];
+		sprintf(bsp_name, "%s.bsp", vehicle_name_by_id(i));
 
-	game_remove_players(game);
+		bin_t* bsp_data = arc_find_data(&data->common, bsp_name);
+		if (!bsp_data)
+			continue;
+
+		if (!bsp_parser.parse(&data->bsps[i], bsp_data))
+		{
+			printf("Failed to parse %s\n", bsp_name);
+			return 0;
+		}
+		data->bsp_found[i] = true;
+	}
+
+	data->stats_vehicles = min(data->kartparam.section_count, (uint32_t)vehicle_max_id);
+	data->stats_characters = data->driverparam.section_count;
+	data->stats = malloc(max((size_t)data->stats_vehicles * data->stats_characters, 1) * sizeof(param_section_t));
+
+	for (uint32_t i = 0; i < data->stats_vehicles; i++)
+	{
+		for (uint32_t j = 0; j < data->stats_characters; j++)
+		{
+			param_merge(
+				&data->kartparam.sections[i],
+				&data->driverparam.sections[j],
+				&data->stats[i * data->stats_characters + j]);
+		}
+	}
+
+	return 1;
 }
 
-int	game_load(game_t* game, const char* common_path)
+int	game_data_load(game_data_t* data, const char* common_path)
 {
 	int ret = 0;
 
-	if (!parser_read(&arc_parser, &game->common, common_path))
-	{
-		printf("Couldn't parse %s\n", common_path);
+	if (!arc_open(&data->common, common_path))
 		goto cleanup;
-	}
 
 	parser_pair_t files[] =
 	{
-		{ "kartParam.bin",			&game->kartparam,   &param_parser,     NULL },
-		{ "driverParam.bin",		&game->driverparam, &param_parser,     NULL },
-		{ "bikePartsDispParam.bin", &game->bikeparts,   &bikeparts_parser, NULL },
+		{ "kartParam.bin",			&data->kartparam,   &param_parser,     NULL },
+		{ "driverParam.bin",		&data->driverparam, &param_parser,     NULL },
+		{ "bikePartsDispParam.bin", &data->bikeparts,   &bikeparts_parser, NULL },
 	};
 
 	for (int i = 0; i < ARRAY_LEN(files); i++)
 	{
 		parser_pair_t* pair = &files[i];
-		pair->bin = arc_find_data(&game->common, pair->filename);
+		pair->bin = arc_find_data(&data->common, pair->filename);
 		if (!pair->bin)
 		{
 			printf("Failed to find %s\n", pair->filename);
@@ -80,65 +121,127 @@ int	game_load(game_t* game, const char* common_path)
 		}
 	}
 
+	if (!game_data_load_vehicles(data))
+		goto cleanup;
+
 	ret = 1;
 
 cleanup:
+	/* the course cache stays, loader threads may already be using it */
 	if (ret != 1)
-		game_free(game);
+	{
+		arc_parser.free(&data->common);
+		param_parser.free(&data->kartparam);
+		param_parser.free(&data->driverparam);
+		bikeparts_parser.free(&data->bikeparts);
+		game_data_free_vehicles(data);
+	}
 
 	return ret;
 }
 
-int game_load_course(game_t* game, const char* course_dir, uint8_t course_id)
+void game_init(game_t* game, game_data_t* data)
 {
-	int ret = 0;
-	const char* course_name = course_name_by_id(course_id);
-	if (!course_name[0])
-	{
-		printf("Failed to load course, invalid ID %u\n", course_id);
-		goto cleanup;
-	}
+	game->data = data;
+	game->course = NULL;
 
-	char course_path[_MAX_PATH];
-	sprintf(course_path, "%s/%s.szs", course_dir, course_name);
+	rkg_parser.init(&game->ghost);
+	rkrd_parser.init(&game->keyframes);
+	rkrd_check_init(&game->check);
 
-	if (!parser_read(&course_parser, &game->course, course_path))
-	{
-		printf("Failed to load course %s, parsing error\n", course_name);
-		goto cleanup;
-	}
+	arena_init(&game->arena, game_max_players * 
+		(ARENA_SIZE(sizeof(player_t)) + ARENA_SIZE(sizeof(vehicle_t))));
 
-	ret = 1;
+	game->player_count = 0;
 
-cleanup:
-	if (ret != 1)
-		course_parser.free(&game->course);
+	game->frame_idx = 0;
+	game->frame_delta = 0.0;
 
-	return ret;
+	game->output = NULL;
+	game->diagnose = NULL;
+
+	game->override_input = false;
+	game->pause = false;
+	game->step = false;
 }
 
-int game_load_ghost(game_t* game, const char* course_dir, const char* ghost_path)
+void game_free(game_t* game)
 {
-	int ret = 0;
-	player_t* player = NULL;
+	game_unload_course(game);
 
-	if (!parser_read(&rkg_parser, &game->ghost, ghost_path))
-		goto cleanup;
+	rkg_parser.free(&game->ghost);
+	rkrd_parser.free(&game->keyframes);
+
+	game_remove_players(game);
+	arena_free(&game->arena);
+}
+
+int game_load_course(game_t* game, const char* course_dir, uint8_t course_id)
+{
+	course_t* course = course_cache_acquire(&game->data->courses, course_dir, course_id);
+	if (!course)
+		return 0;
+
+	course_cache_release(&game->data->courses, game->course);
+	game->course = course;
+	return 1;
+}
+
+void game_unload_course(game_t* game)
+{
+	course_cache_release(&game->data->courses, game->course);
+	game->course = NULL;
+}
+
+/* the ghost's inputs and keyframes, everything game_load_ghost reads that doesn't need a game */
+int game_read_ghost(rkg_t* ghost, rkrd_t* keyframes, const char* ghost_path)
+{
+	rkg_parser.init(ghost);
+	rkrd_parser.init(keyframes);
+	if (!parser_read(&rkg_parser, ghost, ghost_path))
+	{
+		rkg_parser.free(ghost);
+		return 0;
+	}
 
-	strcpy(game->ghost.name, ghost_path);
+	strcpy(ghost->name, ghost_path);
 
+	/* the .rkrd decodes faster, a packed .rkrz from -pack-traces is only used without one */
 	char keyframes_path[_MAX_PATH];
 	strext(keyframes_path, ghost_path, "rkrd");
 
-	if (!parser_read(&rkrd_parser, &game->keyframes, keyframes_path))
-		goto cleanup;
+	FILE* keyframes_file = fopen(keyframes_path, "rb");
+	if (keyframes_file)
+		fclose(keyframes_file);
+	else
+		strext(keyframes_path, ghost_path, "rkrz");
+
+	if (!rkrd_open(keyframes, keyframes_path))
+	{
+		rkg_parser.free(ghost);
+		return 0;
+	}
+
+	return 1;
+}
+
+/* takes over a ghost from game_read_ghost and a course_cache reference, freeing them on failure */
+int game_start_ghost(game_t* game, rkg_t* ghost, rkrd_t* keyframes, course_t* course)
+{
+	int ret = 0;
+	player_t* player = NULL;
+	size_t arena_mark_start = arena_mark(&game->arena);
 
-	if (!game_load_course(game, course_dir, game->ghost.header.course_id))
+	game->ghost = *ghost;
+	game->keyframes = *keyframes;
+
+	course_cache_release(&game->data->courses, game->course);
+	game->course = course;
+	if (!course)
 		goto cleanup;
 
-	player = malloc(sizeof(player_t));
-	player_init(player);
-	if (!player_load_ghost(player, game, &game->ghost))
+	player = game_new_player(game);
+	if (!player || !player_load_ghost(player, game, &game->ghost))
 		goto cleanup;
 
 	game->frame_idx = 0;
@@ -149,6 +252,8 @@ cleanup:
 	{
 		if (player)
 			player_free(player);
+		arena_rewind(&game->arena, arena_mark_start);
+		game_unload_course(game);
 		rkrd_parser.free(&game->keyframes);
 		rkg_parser.free(&game->ghost);
 	}
@@ -156,9 +261,20 @@ cleanup:
 	return ret;
 }
 
+int game_load_ghost(game_t* game, const char* course_dir, const char* ghost_path)
+{
+	rkg_t ghost;
+	rkrd_t keyframes;
+	if (!game_read_ghost(&ghost, &keyframes, ghost_path))
+		return 0;
+
+	course_t* course = course_cache_acquire(&game->data->courses, course_dir, ghost.header.course_id);
+	return game_start_ghost(game, &ghost, &keyframes, course);
+}
+
 void game_unload_ghost(game_t* game)
 {
-	course_parser.free(&game->course);
+	game_unload_course(game);
 
 	rkg_parser.free(&game->ghost);
 	rkrd_parser.free(&game->keyframes);
@@ -166,52 +282,23 @@ void game_unload_ghost(game_t* game)
 	game_remove_players(game);
 }
 
-void game_input(game_t* game, const uint8_t* key_state, float mouse_x, float mouse_y)
+/* rolls every player's input, then feeds the ghost player its inputs unless the caller drives it with override_input */
+void game_input(game_t* game)
 {
-	player_t* player = game->players[0];
-	memcpy(&player->input_last, &player->input, sizeof(player->input_last));
+	for (int i = 0; i < game->player_count; i++)
+		game->players[i]->input_last = game->players[i]->input;
 
-	if (game->override_input)
-	{
-		input_t* input = &game->players[0]->input;
-
-		uint8_t trick = 0;
-		if (key_state[SDL_SCANCODE_UP])
-			trick = trick_up;
-		else if (key_state[SDL_SCANCODE_DOWN])
-			trick = trick_down;
-		else if (key_state[SDL_SCANCODE_LEFT])
-			trick = trick_left;
-		else if (key_state[SDL_SCANCODE_RIGHT])
-			trick = trick_up;
-
-		float stick_x = 0.0f, stick_y = 0.0f;
-		if (key_state[SDL_SCANCODE_W])
-			stick_y = 1.0f;
-		else if (key_state[SDL_SCANCODE_S])
-			stick_y = -1.0f;
-
-		if (key_state[SDL_SCANCODE_D])
-			stick_x = 1.0f;
-		else if (key_state[SDL_SCANCODE_A])
-			stick_x = -1.0f;
-
-		input->accelerate = stick_y > 0.0f;
-		input->brake	  = stick_y < 0.0f;
-		input->use_item   = key_state[SDL_SCANCODE_E] != 0;
-		input->drift	  = key_state[SDL_SCANCODE_SPACE] != 0;
-		input->stick_x	  = stick_x;
-		input->stick_y    = stick_y;
-		input->trick      = trick;
-	}
-	else if (game->ghost.frame_count != 0)
+	if (game->override_input || game->player_count == 0)
+		return;
+
+	if (game->ghost.frame_count != 0)
 	{
+		player_t* player = game->players[0];
 		if (game->frame_idx >= stage_frame_countdown)
 		{
 			if (game->frame_idx < game->ghost.frame_count + stage_frame_countdown)
 			{
-				input_t* frame = &game->ghost.frames[game->frame_idx - stage_frame_countdown];
-				memcpy(&player->input, frame, sizeof(player->input));
+				player->input = game->ghost.frames[game->frame_idx - stage_frame_countdown];
 			}
 		}
 		else
@@ -219,67 +306,6 @@ void game_input(game_t* game, const uint8_t* key_state, float mouse_x, float mou
 			memset(&player->input, 0, sizeof(player->input));
 		}
 	}
-
-	if (key_state)
-	{
-		if (key_state[SDL_SCANCODE_Z] && !player->last_key_state[SDL_SCANCODE_Z])
-			game->override_input = !game->override_input;
-
-		if (key_state[SDL_SCANCODE_C] && !player->last_key_state[SDL_SCANCODE_C])
-			game->pause = !game->pause;
-
-		if (key_state[SDL_SCANCODE_X] && !player->last_key_state[SDL_SCANCODE_X])
-			player->freecam = !player->freecam;
-
-		if (game->pause && key_state[SDL_SCANCODE_RIGHT] && !player->last_key_state[SDL_SCANCODE_RIGHT])
-			game->step = true;
-
-		if (player->freecam)
-		{
-			camera_t* camera = &game->graphics->camera;
-
-			vec3_t new_pos = camera->pos;
-			quat_t new_quat = camera->quat;
-			float speed = camera->speed;
-
-			if (key_state[SDL_SCANCODE_LSHIFT])
-				speed *= 3.0f;
-
-			if (key_state[SDL_SCANCODE_W])
-				vec3_muladd(&new_pos, -speed, &camera->front, &new_pos);
-			if (key_state[SDL_SCANCODE_S])
-				vec3_muladd(&new_pos, speed, &camera->front, &new_pos);
-			if (key_state[SDL_SCANCODE_A])
-				vec3_muladd(&new_pos, -speed, &camera->right, &new_pos);
-			if (key_state[SDL_SCANCODE_D])
-				vec3_muladd(&new_pos, speed, &camera->right, &new_pos);
-			if (key_state[SDL_SCANCODE_SPACE])
-				vec3_muladd(&new_pos, -speed, &camera->up, &new_pos);
-
-			if (mouse_x != 0.0f || mouse_y != 0.0f)
-			{
-				vec3_t new_ang = camera->angles;
-
-				new_ang.x += mouse_y * camera->sensitivity;
-				new_ang.y -= mouse_x * camera->sensitivity;
-
-				new_ang.y = anglenormf(new_ang.y);
-				new_ang.x = clampf(new_ang.x, -90.0f, 90.0f);
-
-				camera->angles = new_ang;
-
-				vec3_radians(&new_ang, &new_ang);
-				quat_init_angles(&new_quat, &new_ang);
-
-				vec3_t end_ang;
-				quat_angles(&new_quat, &end_ang);
-			}
-
-			camera_set_transform(camera, &new_pos, &new_quat);
-		}
-
-		memcpy(&player->last_key_state, key_state, sizeof(player->last_key_state));
-	}
 }
 
 void game_simulate(game_t* game, double deltatime)
@@ -296,34 +322,40 @@ void game_simulate(game_t* game, double deltatime)
 
 	if (game->ghost.frame_count != 0)
 	{
-		if (game->keyframes.frame_desync == UINT32_MAX 
-			&& prev_frame_idx < game->keyframes.frame_count)
-		{
-			rkrd_frame_t* rkrd_frame = &game->keyframes.frames[prev_frame_idx];
-			player_t* player = game->players[0];
-
-			if (!rkrd_check_desync(rkrd_frame, &player->vehicle->physics))
-				game->keyframes.frame_desync = prev_frame_idx;
-		}
+		player_t* player = game->players[0];
+		rkrd_check_frame(&game->keyframes, prev_frame_idx, &player->vehicle->physics, &game->check);
 	}
 
 	game->step = false;
 }
 
-void game_add_player(game_t* game, player_t* player)
+player_t* game_new_player(game_t* game)
+{
+	player_t* player = arena_alloc(&game->arena, sizeof(player_t));
+	if (player)
+		player_init(player);
+	return player;
+}
+
+int game_add_player(game_t* game, player_t* player)
 {
-	game->player_count++;
-	game->players = realloc(game->players, game->player_count * sizeof(*game->players));
-	game->players[game->player_count - 1] = player;
+	if (game->player_count >= game_max_players)
+	{
+		printf("Too many players (max %d)\n", game_max_players);
+		return 0;
+	}
+
+	game->players[game->player_count++] = player;
+	return 1;
 }
 
+/* everything the players allocated came from the arena, so it all goes at once */
 void game_remove_players(game_t* game)
 {
 	for (int i = 0; i < game->player_count; i++)
 		player_free(game->players[i]);
-	free(game->players);
-	game->players = NULL;
 	game->player_count = 0;
+	arena_reset(&game->arena);
 }
 
 int game_get_stage(game_t* game)
@@ -6,9 +6,9 @@
 #include "../fs/rkg.h"
 #include "../fs/rkrd.h"
 #include "../player/player.h"
+#include "../vehicle/vehicle.h"
 #include "../course/course.h"
-
-typedef struct graphics_t graphics_t;
+#include "../course/course_cache.h"
 
 enum
 {
@@ -24,16 +24,44 @@ enum
 	stage_frame_race      = 410,
 };
 
-typedef struct game_t
+/* shared between every game simulating in parallel, read-only after load */
+typedef struct game_data_t
 {
 	arc_t			common;
-	course_t		course;
 
 	param_t			kartparam;
 	param_t			driverparam;
 	bikeparts_t		bikeparts;
 
-	player_t**		players;
+	/* built once by game_data_load, vehicles point into these instead of parsing their own */
+	bsp_t			bsps[vehicle_max_id];
+	bool			bsp_found[vehicle_max_id];
+	param_section_t* stats;			/* kart + driver, by vehicle_id * stats_characters + character_id */
+	uint32_t		stats_vehicles;
+	uint32_t		stats_characters;
+
+	course_cache_t	courses;
+} game_data_t;
+
+void game_data_init(game_data_t* data, int course_cache_size);
+void game_data_free(game_data_t* data);
+int  game_data_load(game_data_t* data, const char* common_path);
+int  game_data_load_vehicles(game_data_t* data);
+void game_data_free_vehicles(game_data_t* data);
+
+enum { game_max_players = 12 };
+
+typedef struct diagnose_t diagnose_t;
+
+typedef struct game_t
+{
+	game_data_t*	data;
+	course_t*		course;
+
+	/* players and vehicles live here, sized for game_max_players up front */
+	arena_t			arena;
+
+	player_t*		players[game_max_players];
 	int				player_count;
 
 	uint32_t		frame_idx;
@@ -41,23 +69,28 @@ typedef struct game_t
 
 	rkg_t			ghost;
 	rkrd_t			keyframes;
+	rkrd_check_t	check;
 
-	graphics_t*		graphics;
+	strbuf_t*		output;
+	diagnose_t*		diagnose;
 
 	bool			override_input;
 	bool			pause;
 	bool			step;
 } game_t;
 
-void game_init(game_t* game);
+void game_init(game_t* game, game_data_t* data);
 void game_free(game_t* game);
-int	 game_load(game_t* game, const char* common_path);
 int  game_load_course(game_t* game, const char* course_dir, uint8_t course_id);
+void game_unload_course(game_t* game);
+int  game_read_ghost(rkg_t* ghost, rkrd_t* keyframes, const char* ghost_path);
+int  game_start_ghost(game_t* game, rkg_t* ghost, rkrd_t* keyframes, course_t* course);
 int  game_load_ghost(game_t* game, const char* course_dir, const char* ghost_path);
 void game_unload_ghost(game_t* game);
-void game_input(game_t* game, const uint8_t* key_state, float mouse_x, float mouse_y);
+void game_input(game_t* game);
 void game_simulate(game_t* game, double deltatime);
 
-void game_add_player(game_t* game, player_t* player);
+player_t* game_new_player(game_t* game);
+int  game_add_player(game_t* game, player_t* player);
 void game_remove_players(game_t* game);
 int  game_get_stage(game_t* game);
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include "../common.h"
+#include "loader.h"
+
+void loader_init(loader_t* loader, game_data_t* data, const char* course_dir, uint32_t ghost_count, uint32_t ahead)
+{
+	loader->data = data;
+	loader->course_dir = course_dir;
+
+	loader->ghosts = calloc(max(ghost_count, 1), sizeof(*loader->ghosts));
+	loader->order = malloc(max(ghost_count, 1) * sizeof(*loader->order));
+	loader->ghost_count = ghost_count;
+	loader->next = 0;
+	loader->ahead = ahead;
+	loader->waiting = 0;
+	loader->stop = false;
+
+	for (uint32_t i = 0; i < ghost_count; i++)
+	{
+		loader->ghosts[i].state = loader_pending;
+		loader->order[i] = i;
+	}
+
+	loader->mutex = mutex_create();
+	loader->cond = cond_create();
+	loader->thread_count = 0;
+}
+
+void loader_free(loader_t* loader)
+{
+	mutex_lock(loader->mutex);
+	loader->stop = true;
+	cond_broadcast(loader->cond);
+	mutex_unlock(loader->mutex);
+
+	for (int i = 0; i < loader->thread_count; i++)
+		thread_join(loader->threads[i]);
+	loader->thread_count = 0;
+
+	/* read ahead but never asked for */
+	for (uint32_t i = 0; i < loader->ghost_count; i++)
+	{
+		loader_ghost_t* entry = &loader->ghosts[i];
+		if (entry->state != loader_ready || !entry->read)
+			continue;
+
+		course_cache_release(&loader->data->courses, entry->course);
+		rkrd_parser.free(&entry->keyframes);
+		rkg_parser.free(&entry->ghost);
+	}
+
+	free(loader->ghosts);
+	free(loader->order);
+	loader->ghosts = NULL;
+	loader->order = NULL;
+	loader->ghost_count = 0;
+
+	cond_free(loader->cond);
+	mutex_free(loader->mutex);
+}
+
+int loader_thread(void* userdata)
+{
+	loader_t* loader = userdata;
+
+	mutex_lock(loader->mutex);
+	for (;;)
+	{
+		while (!loader->stop && loader->next < loader->ghost_count && loader->waiting >= loader->ahead)
+			cond_wait(loader->cond, loader->mutex);
+
+		if (loader->stop || loader->next >= loader->ghost_count)
+			break;
+
+		loader_ghost_t* entry = &loader->ghosts[loader->order[loader->next++]];
+		if (entry->state != loader_pending)
+			continue;
+
+		entry->state = loader_reading;
+		loader->waiting++;
+		mutex_unlock(loader->mutex);
+
+		entry->read = game_read_ghost(&entry->ghost, &entry->keyframes, entry->path);
+		entry->course = entry->read
+			? course_cache_acquire(&loader->data->courses, loader->course_dir, entry->ghost.header.course_id)
+			: NULL;
+
+		mutex_lock(loader->mutex);
+		entry->state = loader_ready;
+		cond_broadcast(loader->cond);
+	}
+	mutex_unlock(loader->mutex);
+
+	return 0;
+}
+
+void loader_start(loader_t* loader, int thread_count)
+{
+	if (loader->ahead == 0)
+		return;
+
+	thread_count = min(thread_count, loader_max_threads);
+	for (int i = 0; i < thread_count; i++)
+	{
+		thread_t* thread = thread_create(loader_thread, loader);
+		if (thread)
+			loader->threads[loader->thread_count++] = thread;
+	}
+}
+
+/* hands ghost idx to the game like game_load_ghost, waiting if an I/O thread is still reading it */
+int loader_take(loader_t* loader, uint32_t idx, game_t* game)
+{
+	loader_ghost_t* entry = &loader->ghosts[idx];
+
+	mutex_lock(loader->mutex);
+	if (entry->state == loader_pending)
+	{
+		entry->state = loader_taken;
+		mutex_unlock(loader->mutex);
+		return game_load_ghost(game, loader->course_dir, entry->path);
+	}
+
+	while (entry->state == loader_reading)
+		cond_wait(loader->cond, loader->mutex);
+
+	entry->state = loader_taken;
+	loader->waiting--;
+	cond_broadcast(loader->cond);
+	mutex_unlock(loader->mutex);
+
+	if (!entry->read)
+		return 0;
+
+	return game_start_ghost(game, &entry->ghost, &entry->keyframes, entry->course);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "game.h"
+
+enum
+{
+	loader_pending,
+	loader_reading,
+	loader_ready,
+	loader_taken,
+};
+
+enum { loader_max_threads = 2 };
+
+/* one ghost's files and course, read ahead of the game that simulates it */
+typedef struct
+{
+	const char*		path;
+	int				state;
+	bool			read;
+	rkg_t			ghost;
+	rkrd_t			keyframes;
+	course_t*		course;
+} loader_ghost_t;
+
+/*
+* Small pool of I/O threads reading ghosts, keyframes and courses in the order
+* games are expected to ask for them, at most ahead ghosts past what has been
+* taken. A game asking for a ghost nobody started reads it itself
+*/
+typedef struct loader_t
+{
+	game_data_t*	data;
+	const char*		course_dir;
+
+	loader_ghost_t*	ghosts;
+	uint32_t*		order;
+	uint32_t		ghost_count;
+	uint32_t		next;
+	uint32_t		ahead;
+	uint32_t		waiting;
+	bool			stop;
+
+	mutex_t*		mutex;
+	cond_t*			cond;
+	thread_t*		threads[loader_max_threads];
+	int				thread_count;
+} loader_t;
+
+void loader_init (loader_t* loader, game_data_t* data, const char* course_dir, uint32_t ghost_count, uint32_t ahead);
+void loader_free (loader_t* loader);
+void loader_start(loader_t* loader, int thread_count);
+int  loader_take (loader_t* loader, uint32_t idx, game_t* game);
@@ -0,0 +1,190 @@
+#include "../common.h"
+#include "../course/course.h"
+#include "../vehicle/vehicle.h"
+#include "report.h"
+
+const char* report_status_names[] = { "ok", "desync", "failed" };
+
+int report_format_by_name(const char* name)
+{
+	if (!stricmp(name, "json"))
+		return report_json;
+	if (!stricmp(name, "csv"))
+		return report_csv;
+	return report_none;
+}
+
+/* written once around all the records, and between each of them */
+const char* report_begin(int format)
+{
+	if (format == report_json)
+		return "[\n";
+	if (format == report_csv)
+		return "ghost,status,course_id,course,vehicle_id,vehicle,character_id,frames,frame_count,"
+			"desync_frame,desync_fields,desync_actual,desync_expected,desync_frames,time_ms,fps\n";
+	return "";
+}
+
+const char* report_separator(int format)
+{
+	return format == report_json ? ",\n" : "";
+}
+
+const char* report_end(int format)
+{
+	return format == report_json ? "\n]\n" : "";
+}
+
+/* quotes doubled for csv */
+void report_string(int format, strbuf_t* output, const char* str)
+{
+	if (format == report_json)
+	{
+		strbuf_json_string(output, str);
+		return;
+	}
+
+	strbuf_printf(output, "\"");
+	for (; *str; str++)
+	{
+		if (*str == '"')
+			strbuf_printf(output, "\"\"");
+		else
+			strbuf_printf(output, "%c", *str);
+	}
+	strbuf_printf(output, "\"");
+}
+
+/* raw float bits, so values compare exactly */
+void report_bits(strbuf_t* output, float* values, int count, const char* quote, const char* separator)
+{
+	for (int i = 0; i < count; i++)
+	{
+		float_bits bits = { .val = values[i] };
+		strbuf_printf(output, "%s%s%08" PRIx32 "%s", i ? separator : "", quote, bits.bits, quote);
+	}
+}
+
+void report_write_json(report_record_t* record, strbuf_t* output)
+{
+	strbuf_printf(output, "{\"ghost\": ");
+	report_string(report_json, output, record->ghost_path);
+	strbuf_printf(output, ", \"status\": \"%s\"", report_status_names[record->status]);
+
+	if (record->has_header)
+	{
+		strbuf_printf(output, ", \"course_id\": %u, \"course\": \"%s\", \"vehicle_id\": %u, \"vehicle\": \"%s\", \"character_id\": %u",
+			record->course_id, course_name_by_id(record->course_id),
+			record->vehicle_id, vehicle_name_by_id(record->vehicle_id), record->character_id);
+	}
+	else
+	{
+		strbuf_printf(output, ", \"course_id\": null, \"course\": null, \"vehicle_id\": null, \"vehicle\": null, \"character_id\": null");
+	}
+
+	strbuf_printf(output, ", \"frames\": %u, \"frame_count\": %u, \"desync_frame\": ", record->frames, record->frame_count);
+	if (record->status == report_status_desync)
+		strbuf_printf(output, "%u", record->frame_desync);
+	else
+		strbuf_printf(output, "null");
+
+	strbuf_printf(output, ", \"desync\": [");
+	if (record->status == report_status_desync)
+	{
+		bool first = true;
+		for (int field = 0; field < rkrd_field_max; field++)
+		{
+			if (!(record->desync->field_mask & (1u << field)))
+				continue;
+
+			strbuf_printf(output, "%s{\"field\": \"%s\", \"actual\": [", first ? "" : ", ", rkrd_field_names[field]);
+			report_bits(output, record->desync->actual.values[field], rkrd_field_sizes[field], "\"", ", ");
+			strbuf_printf(output, "], \"expected\": [");
+			report_bits(output, record->desync->expected.values[field], rkrd_field_sizes[field], "\"", ", ");
+			strbuf_printf(output, "]}");
+			first = false;
+		}
+	}
+
+	strbuf_printf(output, "], \"desync_frames\": %u, \"desync_spans\": [", record->stats->desync_frames);
+	if (record->status == report_status_desync)
+	{
+		bool first = true;
+		for (int field = 0; field < rkrd_field_max; field++)
+		{
+			rkrd_field_stats_t* field_stats = &record->stats->fields[field];
+			if (field_stats->frames == 0)
+				continue;
+
+			strbuf_printf(output, "%s{\"field\": \"%s\", \"frames\": %u, \"spans\": %u, \"first\": %u, \"last\": %u, \"longest\": %u}",
+				first ? "" : ", ", rkrd_field_names[field], field_stats->frames, field_stats->spans,
+				field_stats->first, field_stats->last, field_stats->longest);
+			first = false;
+		}
+	}
+
+	strbuf_printf(output, "], \"time_ms\": %.3f, \"fps\": %.1f}",
+		record->time * 1000.0, record->time > 0.0 ? record->frames / record->time : 0.0);
+}
+
+/* desynced fields and their bits are ; separated lists, components space separated */
+void report_write_csv(report_record_t* record, strbuf_t* output)
+{
+	report_string(report_csv, output, record->ghost_path);
+	strbuf_printf(output, ",%s,", report_status_names[record->status]);
+
+	if (record->has_header)
+	{
+		strbuf_printf(output, "%u,%s,%u,%s,%u,",
+			record->course_id, course_name_by_id(record->course_id),
+			record->vehicle_id, vehicle_name_by_id(record->vehicle_id), record->character_id);
+	}
+	else
+	{
+		strbuf_printf(output, ",,,,,");
+	}
+
+	strbuf_printf(output, "%u,%u,", record->frames, record->frame_count);
+
+	if (record->status == report_status_desync)
+	{
+		strbuf_printf(output, "%u,", record->frame_desync);
+
+		for (int column = 0; column < 3; column++)
+		{
+			bool first = true;
+			for (int field = 0; field < rkrd_field_max; field++)
+			{
+				if (!(record->desync->field_mask & (1u << field)))
+					continue;
+
+				if (!first)
+					strbuf_printf(output, ";");
+				if (column == 0)
+					strbuf_printf(output, "%s", rkrd_field_names[field]);
+				else
+				{
+					rkrd_values_t* values = column == 1 ? &record->desync->actual : &record->desync->expected;
+					report_bits(output, values->values[field], rkrd_field_sizes[field], "", " ");
+				}
+				first = false;
+			}
+			strbuf_printf(output, ",");
+		}
+	}
+	else
+	{
+		strbuf_printf(output, ",,,,");
+	}
+
+	strbuf_printf(output, "%u,", record->stats->desync_frames);
+	strbuf_printf(output, "%.3f,%.1f\n", record->time * 1000.0, record->time > 0.0 ? record->frames / record->time : 0.0);
+}
+
+void report_write(int format, report_record_t* record, strbuf_t* output)
+{
+	if (format == report_json)
+		report_write_json(record, output);
+	else if (format == report_csv)
+		report_write_csv(record, output);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "../fs/rkrd.h"
+
+/* one record per simulated ghost, for tools instead of scraping the console */
+enum
+{
+	report_none,
+	report_json,
+	report_csv,
+};
+
+enum
+{
+	report_status_ok,
+	report_status_desync,
+	report_status_failed,
+};
+
+typedef struct report_record_t
+{
+	const char*		ghost_path;
+	int				status;
+	bool			has_header;
+	uint8_t			course_id;
+	uint8_t			vehicle_id;
+	uint8_t			character_id;
+	uint32_t		frames;
+	uint32_t		frame_count;
+	uint32_t		frame_desync;
+	rkrd_desync_t*	desync;
+	rkrd_stats_t*	stats;
+	double			time;
+} report_record_t;
+
+int			report_format_by_name(const char* name);
+const char*	report_begin(int format);
+const char*	report_separator(int format);
+const char*	report_end(int format);
+void		report_write(int format, report_record_t* record, strbuf_t* output);
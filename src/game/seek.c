@@ -0,0 +1,275 @@
+#include <stddef.h>
+
+#include "../common.h"
+#include "seek.h"
+
+static const char seek_id[4] = { 'H', 'S', 'N', 'P' };
+
+/* FNV-1a of the ghost inputs, ties a sidecar file to the ghost it was made from */
+uint32_t seek_ghost_hash(game_t* game)
+{
+	uint32_t hash = 0x811C9DC5;
+	const uint8_t* data = (const uint8_t*)game->ghost.frames;
+	size_t size = game->ghost.frame_count * sizeof(*game->ghost.frames);
+
+	for (size_t i = 0; i < size; i++)
+		hash = (hash ^ data[i]) * 0x01000193;
+	return hash ^ game->ghost.header.course_id ^ (game->ghost.header.vehicle_id << 8) ^ (game->ghost.header.character_id << 16);
+}
+
+size_t seek_stride(game_t* game)
+{
+	return ARENA_SIZE(offsetof(snapshot_t, players) + game->player_count * sizeof(snapshot_player_t));
+}
+
+snapshot_t* seek_snapshot(seek_t* seek, uint32_t idx)
+{
+	return (snapshot_t*)(seek->snapshots + idx * seek->stride);
+}
+
+void seek_init(seek_t* seek, uint32_t interval)
+{
+	seek->snapshots	 = NULL;
+	seek->count		 = 0;
+	seek->capacity	 = 0;
+	seek->interval	 = max(interval, 1);
+	seek->stride	 = 0;
+	seek->ghost_hash = 0;
+	seek->diverged	 = false;
+	seek->dirty		 = false;
+}
+
+void seek_free(seek_t* seek)
+{
+	free(seek->snapshots);
+	seek_init(seek, seek->interval);
+}
+
+/* call once the ghost is loaded, before simulating it, this takes the frame 0 snapshot */
+void seek_reset(seek_t* seek, game_t* game)
+{
+	seek->count		 = 0;
+	seek->stride	 = seek_stride(game);
+	seek->ghost_hash = seek_ghost_hash(game);
+	seek->diverged	 = false;
+	seek_record(seek, game);
+	seek->dirty		 = false;
+}
+
+/* 
+	call after every simulated frame. freeroaming diverges from the ghost,
+	so snapshots past the current frame are dropped and none are taken
+*/
+void seek_record(seek_t* seek, game_t* game)
+{
+	uint32_t idx = game->frame_idx / seek->interval;
+
+	if (game->override_input)
+	{
+		seek->count = min(seek->count, idx + 1);
+		seek->diverged = true;
+		return;
+	}
+
+	if (seek->diverged || game->frame_idx % seek->interval != 0 || idx != seek->count)
+		return;
+
+	if (seek->count == seek->capacity)
+	{
+		seek->capacity = max(seek->capacity * 2, 64);
+		seek->snapshots = realloc(seek->snapshots, seek->capacity * seek->stride);
+	}
+
+	snapshot_save(seek_snapshot(seek, seek->count++), game);
+	seek->dirty = true;
+}
+
+/* 
+	replays the ghost up to frame, from the closest snapshot when that saves
+	simulating or the current state left the ghost. returns the frame reached
+*/
+uint32_t seek_to(seek_t* seek, game_t* game, uint32_t frame, double deltatime)
+{
+	if (seek->count == 0)
+		return game->frame_idx;
+
+	uint32_t idx = min(frame / seek->interval, seek->count - 1);
+
+	bool restore = seek->diverged || frame < game->frame_idx || idx * seek->interval > game->frame_idx;
+	if (restore)
+	{
+		if (!snapshot_restore(seek_snapshot(seek, idx), game))
+			return game->frame_idx;
+		seek->diverged = false;
+	}
+
+	bool override_input = game->override_input;
+	game->override_input = false;
+
+	while (game->frame_idx < frame)
+	{
+		game_input(game);
+		game_simulate(game, deltatime);
+		seek_record(seek, game);
+	}
+
+	game->override_input = override_input;
+	return game->frame_idx;
+}
+
+/*
+	simulates from the first snapshot to the second and compares every player's
+	keyframe fields, so snapshots taken by older physics or course data are not
+	resumed from. the game is put back the way it was
+*/
+int seek_verify(game_t* game, uint8_t* snapshots, uint32_t count, size_t stride, double deltatime)
+{
+	if (count < 2)
+		return 1;
+
+	snapshot_t* current = malloc(sizeof(snapshot_t));
+	snapshot_save(current, game);
+
+	snapshot_t* first = (snapshot_t*)snapshots;
+	snapshot_t* second = (snapshot_t*)(snapshots + stride);
+
+	int ret = 0;
+	if (!snapshot_restore(first, game) || second->player_count != game->player_count)
+		goto cleanup;
+
+	bool override_input = game->override_input;
+	game->override_input = false;
+
+	while (game->frame_idx < second->frame_idx)
+	{
+		game_input(game);
+		game_simulate(game, deltatime);
+	}
+
+	game->override_input = override_input;
+
+	ret = game->frame_idx == second->frame_idx;
+	for (int i = 0; i < game->player_count && ret; i++)
+	{
+		rkrd_values_t simulated, stored;
+		rkrd_values_physics(&simulated, &game->players[i]->vehicle->physics);
+		rkrd_values_physics(&stored, &second->players[i].physics);
+		ret = !rkrd_values_mismatch(&simulated, &stored, RKRD_FIELDS_ALL, true);
+	}
+
+cleanup:
+	snapshot_restore(current, game);
+	free(current);
+	return ret;
+}
+
+/* doesn't depend on seek_reset, the stride and ghost come from the game */
+int seek_load(seek_t* seek, game_t* game, const char* filename, double deltatime)
+{
+	int ret = 0;
+	bin_t bin;
+	bin_init(&bin);
+
+	if (!bin_read(&bin, filename))
+		return ret;
+
+	uint8_t* snapshots = NULL;
+
+	seek_header_t* header = (seek_header_t*)bin.buffer;
+	if (bin.size < sizeof(seek_header_t) || memcmp(header->id.cc, seek_id, sizeof(seek_id)))
+	{
+		printf("%s is not a snapshot file\n", filename);
+		goto cleanup;
+	}
+
+	size_t stride = seek_stride(game);
+	uint32_t ghost_hash = seek_ghost_hash(game);
+
+	/* a stale file is not an error, it just gets rebuilt */
+	if (header->version != snapshot_version
+		|| header->stride != stride
+		|| header->ghost_hash != ghost_hash
+		|| header->interval == 0
+		|| header->count == 0)
+		goto cleanup;
+
+	size_t size = (size_t)header->count * header->stride;
+	if (bin.size < sizeof(seek_header_t) + size)
+	{
+		printf("%s is truncated\n", filename);
+		goto cleanup;
+	}
+
+	snapshots = malloc(size);
+	memcpy(snapshots, bin.buffer + sizeof(seek_header_t), size);
+
+	if (!seek_verify(game, snapshots, header->count, stride, deltatime))
+		goto cleanup;
+
+	free(seek->snapshots);
+	seek->snapshots	 = snapshots;
+	snapshots		 = NULL;
+	seek->count		 = header->count;
+	seek->capacity	 = header->count;
+	seek->interval	 = header->interval;
+	seek->stride	 = stride;
+	seek->ghost_hash = ghost_hash;
+	seek->diverged	 = false;
+	seek->dirty		 = false;
+	ret = 1;
+
+cleanup:
+	free(snapshots);
+	bin_free(&bin);
+	return ret;
+}
+
+int seek_save(seek_t* seek, const char* filename)
+{
+	char temp_filename[_MAX_PATH];
+	snprintf(temp_filename, sizeof(temp_filename), "%s.tmp", filename);
+
+	FILE* file = fopen(temp_filename, "wb");
+	if (!file)
+	{
+		printf("Failed to open %s for writing\n", temp_filename);
+		return 0;
+	}
+
+	seek_header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.id.cc, seek_id, sizeof(seek_id));
+	header.version	  = snapshot_version;
+	header.interval	  = seek->interval;
+	header.count	  = seek->count;
+	header.stride	  = (uint32_t)seek->stride;
+	header.ghost_hash = seek->ghost_hash;
+
+	size_t size = seek->count * seek->stride;
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+		&& (size == 0 || fwrite(seek->snapshots, 1, size, file) == size);
+	ok = (fclose(file) == 0) && ok;
+
+	if (!ok)
+	{
+		printf("Failed to write %s\n", temp_filename);
+		remove(temp_filename);
+		return 0;
+	}
+
+	remove(filename);
+	if (rename(temp_filename, filename) != 0)
+	{
+		printf("Failed to move %s to %s\n", temp_filename, filename);
+		remove(temp_filename);
+		return 0;
+	}
+
+	seek->dirty = false;
+	return 1;
+}
+
+void seek_sidecar_path(char* dest, const char* ghost_path)
+{
+	strext(dest, ghost_path, "snap");
+}
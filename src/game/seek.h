@@ -0,0 +1,43 @@
+#pragma once
+
+#include "snapshot.h"
+
+/*
+	snapshots of a ghost playthrough taken every interval frames, so seeking
+	to any frame restores the closest earlier one and simulates at most
+	interval - 1 frames. filled in while playing, or loaded from a sidecar
+	file next to the ghost
+*/
+
+enum { seek_default_interval = 120 };
+
+typedef struct seek_header_t
+{
+	id_t		id;
+	uint32_t	version;
+	uint32_t	interval;
+	uint32_t	count;
+	uint32_t	stride;
+	uint32_t	ghost_hash;
+} seek_header_t;
+
+typedef struct seek_t
+{
+	uint8_t*	snapshots;
+	uint32_t	count;
+	uint32_t	capacity;
+	uint32_t	interval;
+	size_t		stride;
+	uint32_t	ghost_hash;
+	bool		diverged;
+	bool		dirty;
+} seek_t;
+
+void		seek_init(seek_t* seek, uint32_t interval);
+void		seek_free(seek_t* seek);
+void		seek_reset(seek_t* seek, game_t* game);
+void		seek_record(seek_t* seek, game_t* game);
+uint32_t	seek_to(seek_t* seek, game_t* game, uint32_t frame, double deltatime);
+int			seek_load(seek_t* seek, game_t* game, const char* filename, double deltatime);
+int			seek_save(seek_t* seek, const char* filename);
+void		seek_sidecar_path(char* dest, const char* ghost_path);
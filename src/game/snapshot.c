@@ -0,0 +1,179 @@
+#include <stddef.h>
+
+#include "../common.h"
+#include "snapshot.h"
+
+void snapshot_hitbox_save(snapshot_hitbox_t* snapshot, hitbox_t* hitbox)
+{
+	snapshot->pos			 = hitbox->pos;
+	snapshot->last_pos		 = hitbox->last_pos;
+	snapshot->radius		 = hitbox->radius;
+	snapshot->flags			 = hitbox->flags;
+	snapshot->last_pos_valid = hitbox->last_pos_valid;
+}
+
+void snapshot_hitbox_restore(snapshot_hitbox_t* snapshot, hitbox_t* hitbox)
+{
+	hitbox->pos				 = snapshot->pos;
+	hitbox->last_pos		 = snapshot->last_pos;
+	hitbox->radius			 = snapshot->radius;
+	hitbox->flags			 = snapshot->flags;
+	hitbox->last_pos_valid	 = snapshot->last_pos_valid;
+}
+
+void snapshot_wheel_save(snapshot_wheel_t* snapshot, vehicle_wheel_t* wheel)
+{
+	snapshot->axis			 = wheel->axis;
+	snapshot->axis_s		 = wheel->axis_s;
+	snapshot->topmost_pos	 = wheel->topmost_pos;
+	snapshot->pos			 = wheel->pos;
+	snapshot->last_pos		 = wheel->last_pos;
+	snapshot->last_pos_rel	 = wheel->last_pos_rel;
+	snapshot->hitbox_pos_rel = wheel->hitbox_pos_rel;
+	snapshot->collision		 = wheel->collision;
+	snapshot_hitbox_save(&snapshot->hitbox, &wheel->hitbox);
+}
+
+void snapshot_wheel_restore(snapshot_wheel_t* snapshot, vehicle_wheel_t* wheel)
+{
+	wheel->axis				 = snapshot->axis;
+	wheel->axis_s			 = snapshot->axis_s;
+	wheel->topmost_pos		 = snapshot->topmost_pos;
+	wheel->pos				 = snapshot->pos;
+	wheel->last_pos			 = snapshot->last_pos;
+	wheel->last_pos_rel		 = snapshot->last_pos_rel;
+	wheel->hitbox_pos_rel	 = snapshot->hitbox_pos_rel;
+	wheel->collision		 = snapshot->collision;
+	snapshot_hitbox_restore(&snapshot->hitbox, &wheel->hitbox);
+}
+
+void snapshot_player_save(snapshot_player_t* snapshot, player_t* player)
+{
+	vehicle_t* vehicle = player->vehicle;
+
+	snapshot->vehicle_id			 = vehicle->id;
+	snapshot->input					 = player->input;
+	snapshot->input_last			 = player->input_last;
+
+	snapshot->physics				 = vehicle->physics;
+	snapshot->floor					 = vehicle->floor;
+	snapshot->surface_props			 = vehicle->surface_props;
+
+	snapshot->turn					 = vehicle->turn;
+	snapshot->drift					 = vehicle->drift;
+	snapshot->wheelie				 = vehicle->wheelie;
+	snapshot->lean_rot				 = vehicle->lean.rot;
+	snapshot->lean_rot_diff			 = vehicle->lean.rot_diff;
+	snapshot->lean_rot_cap			 = vehicle->lean.rot_cap;
+	snapshot->lean_params			 = (int8_t)lean_get_params(&vehicle->lean);
+	snapshot->dive					 = vehicle->dive;
+
+	for (int i = 0; i < vehicle->body.hitbox_count; i++)
+		snapshot_hitbox_save(&snapshot->body_hitboxes[i], &vehicle->body.hitboxes[i]);
+	snapshot->body_collision		 = vehicle->body.collision;
+	snapshot->body_has_floor_collision = vehicle->body.has_floor_collision;
+
+	for (int i = 0; i < vehicle->wheel_count; i++)
+		snapshot_wheel_save(&snapshot->wheels[i], &vehicle->wheels[i]);
+
+	snapshot->start_boost			 = vehicle->start_boost;
+	snapshot->standstill_boost		 = vehicle->standstill_boost;
+	snapshot->standstill_miniturbo	 = vehicle->standstill_miniturbo;
+	snapshot->ramp_boost			 = vehicle->ramp_boost;
+	snapshot->boost					 = vehicle->boost;
+
+	snapshot->trick					 = vehicle->trick;
+	snapshot->jump_pad				 = vehicle->jump_pad;
+}
+
+void snapshot_player_restore(snapshot_player_t* snapshot, player_t* player)
+{
+	vehicle_t* vehicle = player->vehicle;
+
+	player->input					 = snapshot->input;
+	player->input_last				 = snapshot->input_last;
+
+	vehicle->physics				 = snapshot->physics;
+	vehicle->floor					 = snapshot->floor;
+	vehicle->surface_props			 = snapshot->surface_props;
+
+	vehicle->turn					 = snapshot->turn;
+	vehicle->drift					 = snapshot->drift;
+	vehicle->wheelie				 = snapshot->wheelie;
+	vehicle->lean.rot				 = snapshot->lean_rot;
+	vehicle->lean.rot_diff			 = snapshot->lean_rot_diff;
+	vehicle->lean.rot_cap			 = snapshot->lean_rot_cap;
+	lean_set_params(&vehicle->lean, snapshot->lean_params);
+	vehicle->dive					 = snapshot->dive;
+
+	for (int i = 0; i < vehicle->body.hitbox_count; i++)
+		snapshot_hitbox_restore(&snapshot->body_hitboxes[i], &vehicle->body.hitboxes[i]);
+	vehicle->body.collision			 = snapshot->body_collision;
+	vehicle->body.has_floor_collision = snapshot->body_has_floor_collision;
+
+	for (int i = 0; i < vehicle->wheel_count; i++)
+		snapshot_wheel_restore(&snapshot->wheels[i], &vehicle->wheels[i]);
+
+	vehicle->start_boost			 = snapshot->start_boost;
+	vehicle->standstill_boost		 = snapshot->standstill_boost;
+	vehicle->standstill_miniturbo	 = snapshot->standstill_miniturbo;
+	vehicle->ramp_boost				 = snapshot->ramp_boost;
+	vehicle->boost					 = snapshot->boost;
+
+	vehicle->trick					 = snapshot->trick;
+	vehicle->jump_pad				 = snapshot->jump_pad;
+}
+
+void snapshot_save(snapshot_t* snapshot, game_t* game)
+{
+	snapshot->version		= snapshot_version;
+	snapshot->frame_idx		= game->frame_idx;
+	snapshot->frame_desync	= game->keyframes.frame_desync;
+	snapshot->desync		= game->keyframes.desync;
+	snapshot->stats			= game->keyframes.stats;
+	snapshot->player_count	= game->player_count;
+
+	for (int i = 0; i < game->player_count; i++)
+		snapshot_player_save(&snapshot->players[i], game->players[i]);
+}
+
+/* only valid for the game it was saved from, or one loaded the same way */
+int snapshot_restore(snapshot_t* snapshot, game_t* game)
+{
+	if (snapshot->version != snapshot_version)
+	{
+		printf("Snapshot version %u, expected %u\n", snapshot->version, snapshot_version);
+		return 0;
+	}
+
+	if (snapshot->player_count != game->player_count)
+	{
+		printf("Snapshot has %d players, game has %d\n", snapshot->player_count, game->player_count);
+		return 0;
+	}
+
+	for (int i = 0; i < game->player_count; i++)
+	{
+		if (snapshot->players[i].vehicle_id != game->players[i]->vehicle->id)
+		{
+			printf("Snapshot vehicle mismatch for player %d\n", i);
+			return 0;
+		}
+	}
+
+	game->frame_idx				 = snapshot->frame_idx;
+	game->keyframes.frame_desync = snapshot->frame_desync;
+	game->keyframes.desync		 = snapshot->desync;
+	game->keyframes.stats		 = snapshot->stats;
+
+	for (int i = 0; i < game->player_count; i++)
+		snapshot_player_restore(&snapshot->players[i], game->players[i]);
+
+	return 1;
+}
+
+/* bytes in use, players past player_count are left untouched */
+size_t snapshot_size(snapshot_t* snapshot)
+{
+	return offsetof(snapshot_t, players) + snapshot->player_count * sizeof(snapshot_player_t);
+}
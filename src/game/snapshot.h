@@ -0,0 +1,85 @@
+#pragma once
+
+#include "game.h"
+#include "../vehicle/vehicle.h"
+
+/*
+	complete mutable simulation state of a game, everything player_update touches
+	and how far the keyframe check got, so re-simulated frames are not counted twice.
+	holds no pointers, so it can be copied around, stored or compared as plain bytes.
+	load-time state (course, bsp, params, octree leaf caches) is not included,
+	a snapshot can only be restored into a game with the same course and vehicles
+*/
+
+enum { snapshot_version = 2 };
+
+typedef struct snapshot_hitbox_t
+{
+	vec3_t					pos;
+	vec3_t					last_pos;
+	float					radius;
+	uint32_t				flags;
+	bool					last_pos_valid;
+} snapshot_hitbox_t;
+
+typedef struct snapshot_wheel_t
+{
+	vec3_t					axis;
+	float					axis_s;
+	vec3_t					topmost_pos;
+	vec3_t					pos;
+	vec3_t					last_pos;
+	vec3_t					last_pos_rel;
+	snapshot_hitbox_t		hitbox;
+	vec3_t					hitbox_pos_rel;
+	vehicle_collision_t		collision;
+} snapshot_wheel_t;
+
+typedef struct snapshot_player_t
+{
+	uint8_t					vehicle_id;
+	input_t					input;
+	input_t					input_last;
+
+	physics_t				physics;
+	floor_t					floor;
+	surface_props_t			surface_props;
+
+	turn_t					turn;
+	drift_t					drift;
+	wheelie_t				wheelie;
+	float					lean_rot;
+	float					lean_rot_diff;
+	float					lean_rot_cap;
+	int8_t					lean_params;
+	dive_t					dive;
+
+	snapshot_hitbox_t		body_hitboxes[bsp_max_hitboxes];
+	vehicle_collision_t		body_collision;
+	bool					body_has_floor_collision;
+	snapshot_wheel_t		wheels[bsp_max_wheels];
+
+	start_boost_t			start_boost;
+	standstill_boost_t		standstill_boost;
+	standstill_miniturbo_t  standstill_miniturbo;
+	ramp_boost_t			ramp_boost;
+	boost_t					boost;
+
+	trick_t					trick;
+	jump_pad_t				jump_pad;
+} snapshot_player_t;
+
+typedef struct snapshot_t
+{
+	uint32_t				version;
+	uint32_t				frame_idx;
+	uint32_t				frame_desync;
+	rkrd_desync_t			desync;
+	rkrd_stats_t			stats;
+	int32_t					player_count;
+	snapshot_player_t		players[game_max_players];
+} snapshot_t;
+
+void	snapshot_save(snapshot_t* snapshot, game_t* game);
+int		snapshot_restore(snapshot_t* snapshot, game_t* game);
+size_t	snapshot_size(snapshot_t* snapshot);
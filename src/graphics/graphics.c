@@ -8,6 +8,7 @@
 #include "../game/game.h"
 #include "../course/course.h"
 #include "../vehicle/vehicle.h"
+#include "../physics/physics.h"
 #include "../fs/kcl.h"
 
 #include "shader.h"
@@ -70,6 +71,10 @@ int graphics_init(graphics_t* graphics, SDL_Window* window, int width, int heigh
 	camera->pos_lerp = 1.0f;
 	camera->rot_lerp = 1.0f;
 
+	memset(graphics->last_key_state, 0, sizeof(graphics->last_key_state));
+	graphics->freecam = false;
+	graphics->seek = 0;
+
 	return 1;
 }
 
@@ -83,6 +88,161 @@ void graphics_free(graphics_t* graphics)
 	gltTerminate();
 }
 
+/* keyboard driving, when freeroaming, and the freecam/pause/step toggles */
+void graphics_input(graphics_t* graphics, game_t* game, const uint8_t* key_state, float mouse_x, float mouse_y)
+{
+	if (game->player_count == 0)
+		return;
+
+	if (game->override_input)
+	{
+		input_t* input = &game->players[0]->input;
+
+		uint8_t trick = 0;
+		if (key_state[SDL_SCANCODE_UP])
+			trick = trick_up;
+		else if (key_state[SDL_SCANCODE_DOWN])
+			trick = trick_down;
+		else if (key_state[SDL_SCANCODE_LEFT])
+			trick = trick_left;
+		else if (key_state[SDL_SCANCODE_RIGHT])
+			trick = trick_up;
+
+		float stick_x = 0.0f, stick_y = 0.0f;
+		if (key_state[SDL_SCANCODE_W])
+			stick_y = 1.0f;
+		else if (key_state[SDL_SCANCODE_S])
+			stick_y = -1.0f;
+
+		if (key_state[SDL_SCANCODE_D])
+			stick_x = 1.0f;
+		else if (key_state[SDL_SCANCODE_A])
+			stick_x = -1.0f;
+
+		input->accelerate = stick_y > 0.0f;
+		input->brake	  = stick_y < 0.0f;
+		input->use_item   = key_state[SDL_SCANCODE_E] != 0;
+		input->drift	  = key_state[SDL_SCANCODE_SPACE] != 0;
+		input->stick_x	  = stick_x;
+		input->stick_y    = stick_y;
+		input->trick      = trick;
+	}
+
+	if (key_state)
+	{
+		if (key_state[SDL_SCANCODE_Z] && !graphics->last_key_state[SDL_SCANCODE_Z])
+			game->override_input = !game->override_input;
+
+		if (key_state[SDL_SCANCODE_C] && !graphics->last_key_state[SDL_SCANCODE_C])
+			game->pause = !game->pause;
+
+		if (key_state[SDL_SCANCODE_X] && !graphics->last_key_state[SDL_SCANCODE_X])
+			graphics->freecam = !graphics->freecam;
+
+		if (game->pause && key_state[SDL_SCANCODE_RIGHT] && !graphics->last_key_state[SDL_SCANCODE_RIGHT])
+			game->step = true;
+
+		/* scrubbing replays the ghost, so not while freeroaming */
+		if (!game->override_input)
+		{
+			if (game->pause && key_state[SDL_SCANCODE_LEFT] && !graphics->last_key_state[SDL_SCANCODE_LEFT])
+				graphics->seek = -1;
+			if (key_state[SDL_SCANCODE_PAGEUP] && !graphics->last_key_state[SDL_SCANCODE_PAGEUP])
+				graphics->seek = -600;
+			if (key_state[SDL_SCANCODE_PAGEDOWN] && !graphics->last_key_state[SDL_SCANCODE_PAGEDOWN])
+				graphics->seek = 600;
+			if (key_state[SDL_SCANCODE_HOME] && !graphics->last_key_state[SDL_SCANCODE_HOME])
+				graphics->seek = -(int32_t)game->frame_idx;
+		}
+
+		if (graphics->freecam)
+		{
+			camera_t* camera = &graphics->camera;
+
+			vec3_t new_pos = camera->pos;
+			quat_t new_quat = camera->quat;
+			float speed = camera->speed;
+
+			if (key_state[SDL_SCANCODE_LSHIFT])
+				speed *= 3.0f;
+
+			if (key_state[SDL_SCANCODE_W])
+				vec3_muladd(&new_pos, -speed, &camera->front, &new_pos);
+			if (key_state[SDL_SCANCODE_S])
+				vec3_muladd(&new_pos, speed, &camera->front, &new_pos);
+			if (key_state[SDL_SCANCODE_A])
+				vec3_muladd(&new_pos, -speed, &camera->right, &new_pos);
+			if (key_state[SDL_SCANCODE_D])
+				vec3_muladd(&new_pos, speed, &camera->right, &new_pos);
+			if (key_state[SDL_SCANCODE_SPACE])
+				vec3_muladd(&new_pos, -speed, &camera->up, &new_pos);
+
+			if (mouse_x != 0.0f || mouse_y != 0.0f)
+			{
+				vec3_t new_ang = camera->angles;
+
+				new_ang.x += mouse_y * camera->sensitivity;
+				new_ang.y -= mouse_x * camera->sensitivity;
+
+				new_ang.y = anglenormf(new_ang.y);
+				new_ang.x = clampf(new_ang.x, -90.0f, 90.0f);
+
+				camera->angles = new_ang;
+
+				vec3_radians(&new_ang, &new_ang);
+				quat_init_angles(&new_quat, &new_ang);
+
+				vec3_t end_ang;
+				quat_angles(&new_quat, &end_ang);
+			}
+
+			camera_set_transform(camera, &new_pos, &new_quat);
+		}
+
+		memcpy(graphics->last_key_state, key_state, sizeof(graphics->last_key_state));
+	}
+}
+
+/* chase camera behind the first player, unless the freecam is on */
+void graphics_update_camera(graphics_t* graphics, game_t* game)
+{
+	if (graphics->freecam || game->player_count == 0)
+		return;
+
+	physics_t* physics = &game->players[0]->vehicle->physics;
+	camera_t* camera = &graphics->camera;
+
+	vec3_t camera_target_pos;
+	vec3_muladd(&physics->pos, 200.0f, &vec3_up, &camera_target_pos);
+	vec3_muladd(&camera_target_pos, -400.0f, &physics->dir, &camera_target_pos);
+	vec3_mul(&camera_target_pos, -1.0f, &camera_target_pos);
+
+	vec3_t camera_dir = physics->dir;
+	camera_dir.y = 0.0f;
+	vec3_norm(&camera_dir);
+
+	vec3_t camera_angles_pitch = { 0.0f, atan2f(camera_dir.z, camera_dir.x) - radiansf(90.0f), 0.0f };
+	quat_t camera_quat_pitch;
+	quat_init_angles(&camera_quat_pitch, &camera_angles_pitch);
+	quat_invert(&camera_quat_pitch, &camera_quat_pitch);
+
+	vec3_t camera_angles_yaw = { radiansf(15.0f), 0.0f, 0.0f };
+	quat_t camera_quat_yaw;
+	quat_init_angles(&camera_quat_yaw, &camera_angles_yaw);
+
+	quat_t camera_target_orient;
+	quat_mulq(&camera_quat_pitch, &camera_quat_yaw, &camera_target_orient);
+
+	vec3_t camera_final_pos;
+	quat_t camera_final_orient;
+	vec3_lerp(&camera->pos, &camera_target_pos, camera->pos_lerp, &camera_final_pos);
+	quat_slerp(&camera->quat, &camera_target_orient, camera->rot_lerp, &camera_final_orient);
+
+	camera_set_transform(camera, &camera_final_pos, &camera_final_orient);
+	camera->pos_lerp = 0.90f;
+	camera->rot_lerp = 0.15f;
+}
+
 void graphics_render(graphics_t* graphics, game_t* game)
 {
 	camera_t* camera = &graphics->camera;
@@ -101,8 +261,8 @@ void graphics_render(graphics_t* graphics, game_t* game)
 
 	if (game->player_count > 0)
 		graphics_draw_vehicle(graphics, game->players[0]->vehicle);
-	if (game->course.kcl.tri_count > 0)
-		graphics_draw_kcl(graphics, &game->course.kcl);
+	if (game->course && game->course->kcl.tri_count > 0)
+		graphics_draw_kcl(graphics, &game->course->kcl);
 	graphics_draw_overlay(graphics, game);
 
 	for (GLenum error = glGetError(); error != GL_NO_ERROR; error = glGetError())
@@ -289,13 +449,15 @@ void graphics_draw_overlay(graphics_t* graphics, game_t* game)
 
 		if (game->keyframes.frame_desync != UINT32_MAX)
 			gltDrawText2DFormatAdvance(text, x, y, scale, "Desync %u", game->keyframes.frame_desync);
+		if (game->keyframes.damaged)
+			gltDrawText2DFormatAdvance(text, x, y, scale, "Keyframes damaged");
 
 		y += y_inc;
 	}
 
 	if (game->override_input)
 		gltDrawText2DFormatAdvance(text, x, y, scale, "Freeroam");
-	if (player && player->freecam)
+	if (graphics->freecam)
 		gltDrawText2DFormatAdvance(text, x, y, scale, "Freecam");
 	if (game->pause)
 		gltDrawText2DFormatAdvance(text, x, y, scale, "PAUSED");
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "SDL/SDL_scancode.h"
+
 typedef struct SDL_Window SDL_Window;
 typedef struct GLTtext GLTtext;
 typedef struct shader_t shader_t;
@@ -40,6 +42,9 @@ typedef struct graphics_t
 	GLTtext*	    text;
 	vec3_t		    sun_dir;
 	double		    frametime;
+	uint8_t		    last_key_state[SDL_NUM_SCANCODES];
+	bool		    freecam;
+	int32_t		    seek;
 	unsigned int    vao;
 	unsigned int    vbo;
 	unsigned int    ebo;
@@ -57,6 +62,8 @@ typedef struct graphics_t
 
 int  graphics_init(graphics_t* graphics, SDL_Window* window, int width, int height);
 void graphics_free(graphics_t* graphics);
+void graphics_input(graphics_t* graphics, game_t* game, const uint8_t* key_state, float mouse_x, float mouse_y);
+void graphics_update_camera(graphics_t* graphics, game_t* game);
 void graphics_render(graphics_t* graphics, game_t* game);
 void graphics_draw_sphere(graphics_t* graphics, int rings, int sectors, const vec3_t* pos, const vec3_t* color, float radius);
 void graphics_draw_kcl(graphics_t* graphics, kcl_t* kcl);
@@ -0,0 +1,145 @@
+#include <assert.h>
+#include <xmmintrin.h>
+
+#include "hanachan.h"
+
+int hanachan_data_load(game_data_t* data, const char* common_path, int course_cache_size)
+{
+	game_data_init(data, course_cache_size);
+	if (!game_data_load(data, common_path))
+	{
+		game_data_free(data);
+		return 0;
+	}
+
+	return 1;
+}
+
+void hanachan_data_free(game_data_t* data)
+{
+	game_data_free(data);
+}
+
+hanachan_t* hanachan_create(game_data_t* data)
+{
+	hanachan_t* hanachan = malloc(sizeof(hanachan_t));
+	game_init(&hanachan->game, data);
+	return hanachan;
+}
+
+void hanachan_free(hanachan_t* hanachan)
+{
+	if (!hanachan)
+		return;
+
+	game_free(&hanachan->game);
+	free(hanachan);
+}
+
+int hanachan_load_course(hanachan_t* hanachan, const char* course_dir, uint8_t course_id)
+{
+	return game_load_course(&hanachan->game, course_dir, course_id);
+}
+
+int hanachan_load_ghost(hanachan_t* hanachan, const char* course_dir, const char* ghost_path)
+{
+	return game_load_ghost(&hanachan->game, course_dir, ghost_path);
+}
+
+/* driven by hanachan_set_input, its index is the player count before it was added */
+player_t* hanachan_add_player(hanachan_t* hanachan, uint8_t vehicle_id, uint8_t character_id)
+{
+	game_t* game = &hanachan->game;
+
+	if (!game->course)
+	{
+		printf("No course loaded\n");
+		return NULL;
+	}
+
+	size_t mark = arena_mark(&game->arena);
+
+	player_t* player = game_new_player(game);
+	vehicle_t* vehicle = player ? vehicle_load(player, game, vehicle_id, character_id) : NULL;
+	if (!vehicle)
+	{
+		arena_rewind(&game->arena, mark);
+		return NULL;
+	}
+
+	vehicle_place(vehicle, game->course);
+	if (!game_add_player(game, player))
+	{
+		player_free(player);
+		arena_rewind(&game->arena, mark);
+		return NULL;
+	}
+
+	return player;
+}
+
+/* a loaded ghost is player 0, giving it input stops its recorded inputs */
+void hanachan_set_input(hanachan_t* hanachan, int player_idx, const input_t* input)
+{
+	game_t* game = &hanachan->game;
+	if (player_idx < 0 || player_idx >= game->player_count)
+		return;
+
+	if (player_idx == 0)
+		game->override_input = true;
+	game->players[player_idx]->input = *input;
+}
+
+/* 
+	returns the number of frames actually simulated.
+	never allocates, everything was set up by hanachan_create and the loads
+*/
+uint32_t hanachan_step(hanachan_t* hanachan, uint32_t frames)
+{
+	game_t* game = &hanachan->game;
+	if (!game->course || game->player_count == 0)
+		return 0;
+
+	/* FTZ is per thread, match the game on whichever thread steps us */
+	_MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+
+#if defined( HANACHAN_DEBUG_ALLOC )
+	uint64_t alloc_count = debug_alloc_count();
+#endif
+
+	for (uint32_t i = 0; i < frames; i++)
+	{
+		game_input(game);
+		game_simulate(game, 1.0 / 60.0);
+	}
+
+#if defined( HANACHAN_DEBUG_ALLOC )
+	assert(debug_alloc_count() == alloc_count);
+#endif
+
+	return frames;
+}
+
+void hanachan_save(hanachan_t* hanachan, snapshot_t* snapshot)
+{
+	snapshot_save(snapshot, &hanachan->game);
+}
+
+int hanachan_restore(hanachan_t* hanachan, snapshot_t* snapshot)
+{
+	return snapshot_restore(snapshot, &hanachan->game);
+}
+
+uint32_t hanachan_frame(hanachan_t* hanachan)
+{
+	return hanachan->game.frame_idx;
+}
+
+physics_t* hanachan_physics(hanachan_t* hanachan, int player_idx)
+{
+	game_t* game = &hanachan->game;
+	if (player_idx < 0 || player_idx >= game->player_count)
+		return NULL;
+
+	return &game->players[player_idx]->vehicle->physics;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "common.h"
+#include "game/game.h"
+#include "player/player.h"
+#include "physics/physics.h"
+#include "vehicle/vehicle.h"
+#include "game/snapshot.h"
+
+/* 
+	embedding interface for the headless simulation core, no SDL/GL needed.
+	game data is loaded once and can be shared by any number of sessions,
+	each session owns one game and is stepped by its caller
+*/
+
+typedef struct hanachan_t
+{
+	game_t		game;
+} hanachan_t;
+
+int			hanachan_data_load(game_data_t* data, const char* common_path, int course_cache_size);
+void		hanachan_data_free(game_data_t* data);
+
+hanachan_t*	hanachan_create(game_data_t* data);
+void		hanachan_free(hanachan_t* hanachan);
+
+int			hanachan_load_course(hanachan_t* hanachan, const char* course_dir, uint8_t course_id);
+int			hanachan_load_ghost(hanachan_t* hanachan, const char* course_dir, const char* ghost_path);
+player_t*	hanachan_add_player(hanachan_t* hanachan, uint8_t vehicle_id, uint8_t character_id);
+
+void		hanachan_set_input(hanachan_t* hanachan, int player_idx, const input_t* input);
+uint32_t	hanachan_step(hanachan_t* hanachan, uint32_t frames);
+
+void		hanachan_save(hanachan_t* hanachan, snapshot_t* snapshot);
+int			hanachan_restore(hanachan_t* hanachan, snapshot_t* snapshot);
+
+uint32_t	hanachan_frame(hanachan_t* hanachan);
+physics_t*	hanachan_physics(hanachan_t* hanachan, int player_idx);
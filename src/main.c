@@ -1,19 +1,39 @@
+#if !defined( _WIN32 )
+#define _POSIX_C_SOURCE 200112L /* dup, fileno */
+#endif
+
 #include "SDL/SDL.h"
 #include "tinydir.h"
 
 #include <stdio.h>
 #include <xmmintrin.h>
 
+#if defined( _WIN32 )
+#include <io.h>
+#define dup _dup
+#define dup2 _dup2
+#define fileno _fileno
+#define fdopen _fdopen
+#else
+#include <unistd.h>
+#endif
+
 #include "common.h"
 #include "fs/yaz.h"
 #include "fs/arc.h"
 #include "fs/rkg.h"
 #include "fs/rkrd.h"
+#include "fs/rkrz.h"
 #include "course/course.h"
+#include "course/course_bin.h"
 #include "player/player.h"
 #include "physics/physics.h"
 #include "vehicle/vehicle.h"
 #include "game/game.h"
+#include "game/seek.h"
+#include "game/diagnose.h"
+#include "game/report.h"
+#include "game/loader.h"
 
 #include "graphics/graphics.h"
 
@@ -22,13 +42,23 @@ typedef struct
 	const char* common_path;
 	const char* course_path;
 	const char* ghost_path;
+	const char* diagnose_path;
+	const char* report_path;
+	int			report_format;
+	rkrd_check_t check;
 	double		fps;
 	double		frame_limit;
 	uint32_t	frame_start;
+	uint32_t	seek_interval;
+	int			jobs;
+	int			course_cache;
+	int			preload;
 	int			width;
 	int			height;
 	bool		cli;
 	bool		start_paused;
+	bool		stats;
+	bool		save_snapshots;
 } config_t;
 
 void config_init(config_t* config)
@@ -36,24 +66,48 @@ void config_init(config_t* config)
 	config->common_path       = NULL;
 	config->course_path       = NULL;
 	config->ghost_path	      = NULL;
+	config->diagnose_path     = NULL;
+	config->report_path       = NULL;
+	config->report_format     = report_none;
+	rkrd_check_init(&config->check);
 	config->fps			      = 60.0;
 	config->frame_limit       = 1000.0 / config->fps;
 	config->frame_start       = 0;
+	config->seek_interval     = seek_default_interval;
+	config->jobs              = 1;
+	config->course_cache      = 0;
+	config->preload           = 8;
 	config->width             = 800;
 	config->height            = 600;
 	config->cli			      = false;
 	config->start_paused      = false;
+	config->stats             = false;
+	config->save_snapshots    = false;
 }
 
-int main_graphics(game_t* game, config_t* config)
+int main_graphics(game_t* game, graphics_t* graphics, config_t* config)
 {
 	if (!game_load_ghost(game, config->course_path, config->ghost_path))
 	{
 		printf("Failed to load ghost\n");
 		return 1;
 	}
+
+	double deltatime = config->frame_limit / 1000.0;
+
+	char sidecar_path[_MAX_PATH];
+	seek_sidecar_path(sidecar_path, config->ghost_path);
+
+	seek_t seek;
+	seek_init(&seek, config->seek_interval);
+	seek_reset(&seek, game);
+	seek_load(&seek, game, sidecar_path, deltatime);
+
+	seek_to(&seek, game, config->frame_start, deltatime);
+	graphics_update_camera(graphics, game);
+
+	uint32_t printed_desync = UINT32_MAX;
 	
-	graphics_t* graphics = game->graphics;
 	uint64_t last_time = SDL_GetPerformanceCounter();
 
 	bool quit = false;
@@ -62,8 +116,7 @@ int main_graphics(game_t* game, config_t* config)
 		uint64_t current_time = SDL_GetPerformanceCounter();
 		double elapsed_time = (current_time - last_time) * 1000 / (double)SDL_GetPerformanceFrequency();
 
-		if (game->frame_idx < config->frame_start
-			|| elapsed_time >= config->frame_limit)
+		if (elapsed_time >= config->frame_limit)
 		{
 			graphics->frametime = elapsed_time;
 
@@ -72,17 +125,36 @@ int main_graphics(game_t* game, config_t* config)
 			key_state = SDL_GetKeyboardState(NULL);
 			SDL_GetRelativeMouseState(&mouse_x, &mouse_y);
 
-			game_input(game, key_state, (float)mouse_x, (float)mouse_y);
+			game_input(game);
+			graphics_input(graphics, game, key_state, (float)mouse_x, (float)mouse_y);
 
-			if (game->frame_idx < config->frame_start || !game->pause || game->step)
-				game_simulate(game, config->frame_limit / 1000.0);
+			if (graphics->seek != 0)
+			{
+				int64_t frame = max((int64_t)game->frame_idx + graphics->seek, 0);
+				seek_to(&seek, game, (uint32_t)frame, deltatime);
+				graphics_update_camera(graphics, game);
+				graphics->seek = 0;
+			}
+			else if (!game->pause || game->step)
+			{
+				game_simulate(game, deltatime);
+				seek_record(&seek, game);
+				graphics_update_camera(graphics, game);
+			}
 
-			if (game->frame_idx >= config->frame_start)
+			if (game->keyframes.frame_desync != printed_desync)
 			{
-				graphics_render(graphics, game);
-				SDL_GL_SwapWindow(graphics->window);
+				printed_desync = game->keyframes.frame_desync;
+				if (printed_desync != UINT32_MAX)
+				{
+					printf("Desync at frame %u\n", printed_desync);
+					rkrd_print_desync(&game->keyframes.desync, NULL);
+				}
 			}
 
+			graphics_render(graphics, game);
+			SDL_GL_SwapWindow(graphics->window);
+
 			last_time = current_time;
 
 			SDL_Event event;
@@ -96,41 +168,486 @@ int main_graphics(game_t* game, config_t* config)
 		}
 	}
 
+	if (config->save_snapshots && seek.dirty)
+		seek_save(&seek, sidecar_path);
+	seek_free(&seek);
+
 	game_unload_ghost(game);
 	return 0;
 }
 
-void main_cli_run_ghost(game_t* game, config_t* config, const char* ghost_path)
+/* replay the desynced frame with checkpoints inside player_update and report where it went wrong */
+void main_cli_diagnose(game_t* game, snapshot_t* before, const char* ghost_path, double deltatime, strbuf_t* diagnosis)
 {
-	printf("Ghost: %s\n", ghost_path);
+	uint32_t frame = game->keyframes.frame_desync;
+
+	diagnose_t diagnose;
+	diagnose_init(&diagnose);
+
+	if (!snapshot_restore(before, game))
+		return;
 
-	if (!game_load_ghost(game, config->course_path, ghost_path))
+	/* the checks and stats come back with the snapshot, so the frame is counted once */
+	game->diagnose = &diagnose;
+	game_simulate(game, deltatime);
+	game->diagnose = NULL;
+
+	rkrd_values_t* expected = rkrd_frame(&game->keyframes, frame);
+	if (expected)
 	{
-		printf("Failed to load ghost\n");
+		rkrd_values_t copy = *expected;
+		diagnose_report(&diagnose, &copy, ghost_path, frame, diagnosis);
+	}
+}
+
+void main_cli_run_ghost(game_t* game, config_t* config, loader_t* loader, uint32_t ghost_idx, strbuf_t* report, strbuf_t* diagnosis)
+{
+	const char* ghost_path = loader->ghosts[ghost_idx].path;
+
+	strbuf_printf(game->output, "Ghost: %s\n", ghost_path);
+
+	report_record_t record;
+	record.ghost_path	= ghost_path;
+	record.status		= report_status_failed;
+	record.has_header	= false;
+	record.frames		= 0;
+	record.frame_count	= 0;
+	record.frame_desync = UINT32_MAX;
+	record.desync		= &game->keyframes.desync;
+	record.stats		= &game->keyframes.stats;
+	record.time			= 0.0;
+
+	if (!loader_take(loader, ghost_idx, game))
+	{
+		strbuf_printf(game->output, "Failed to load ghost\n");
+
+		if (report)
+		{
+			rkg_header_t header;
+			if (rkg_read_header(&header, ghost_path))
+			{
+				record.has_header	= true;
+				record.course_id	= header.course_id;
+				record.vehicle_id	= header.vehicle_id;
+				record.character_id = header.character_id;
+			}
+			report_write(config->report_format, &record, report);
+		}
 		return;
 	}
 
+	seek_t seek;
+	seek_init(&seek, config->seek_interval);
+	if (config->save_snapshots)
+		seek_reset(&seek, game);
+
+	/* state going into the current frame, only kept when diagnosing */
+	snapshot_t* before = diagnosis ? malloc(sizeof(snapshot_t)) : NULL;
+
+	uint64_t start_time = SDL_GetPerformanceCounter();
+
 	uint32_t frame;
 	for (;;)
 	{
-		game_input(game, NULL, 0.0f, 0.0f);
+		game_input(game);
+
+		if (before)
+			snapshot_save(before, game);
+
 		game_simulate(game, 1000.0 / config->fps);
 
+		if (before && game->keyframes.frame_desync == game->frame_idx - 1)
+			main_cli_diagnose(game, before, ghost_path, 1000.0 / config->fps, diagnosis);
+
+		if (config->save_snapshots)
+			seek_record(&seek, game);
+
 		frame = game->frame_idx - 1;
-		if (game->keyframes.frame_desync != UINT32_MAX || frame >= game->keyframes.frame_count)
+		if ((game->keyframes.frame_desync != UINT32_MAX && game->check.stop) || frame >= game->keyframes.frame_count
+			|| game->keyframes.damaged)
 			break;
 	}
 
+	free(before);
+
+	record.time = (SDL_GetPerformanceCounter() - start_time) / (double)SDL_GetPerformanceFrequency();
+
+	/* the first desync in full, and only a summary of the rest */
+	if (game->keyframes.frame_desync != UINT32_MAX)
+	{
+		rkrd_print_desync(&game->keyframes.desync, game->output);
+		if (!game->check.stop)
+			rkrd_print_stats(&game->keyframes.stats, game->output);
+	}
+
+	/* the rest of the keyframes can't be trusted, like a ghost that failed to load */
+	if (game->keyframes.damaged)
+		strbuf_printf(game->output, "Failed to read keyframes at frame %u\n", frame);
+
 	uint32_t timer = ssub_uint32(frame, stage_frame_countdown);
-	printf("Simulated %u/%u (in-game: %u) frames\n\n", frame, game->keyframes.frame_count, timer);
+	strbuf_printf(game->output, "Simulated %u/%u (in-game: %u) frames\n", frame, game->keyframes.frame_count, timer);
+
+	if (config->stats)
+	{
+		uint64_t lookups, hits;
+		vehicle_leaf_stats(game->players[0]->vehicle, &lookups, &hits);
+		strbuf_printf(game->output, "Octree leaf cache: %" PRIu64 "/%" PRIu64 " lookups hit (%.1f%%)\n",
+			hits, lookups, lookups ? hits * 100.0 / lookups : 0.0);
+	}
+
+	if (config->save_snapshots)
+	{
+		char sidecar_path[_MAX_PATH];
+		seek_sidecar_path(sidecar_path, ghost_path);
+		if (!seek_save(&seek, sidecar_path))
+			strbuf_printf(game->output, "Failed to save snapshots\n");
+		seek_free(&seek);
+	}
+
+	strbuf_printf(game->output, "\n");
+
+	if (report)
+	{
+		record.status		= game->keyframes.damaged ? report_status_failed
+							: game->keyframes.frame_desync != UINT32_MAX ? report_status_desync : report_status_ok;
+		record.has_header	= true;
+		record.course_id	= game->ghost.header.course_id;
+		record.vehicle_id	= game->ghost.header.vehicle_id;
+		record.character_id = game->ghost.header.character_id;
+		record.frames		= frame;
+		record.frame_count	= game->keyframes.frame_count;
+		record.frame_desync = game->keyframes.frame_desync;
+		report_write(config->report_format, &record, report);
+	}
 
 	game_unload_ghost(game);
 }
 
-int main_cli(game_t* game, config_t* config)
+typedef struct
+{
+	char*			path;
+	strbuf_t		output;
+	strbuf_t		report;
+	strbuf_t		diagnosis;
+	bool			done;
+} cli_job_t;
+
+/* range of batch order indices, owner pops from the head and thieves from the tail */
+typedef struct
+{
+	mutex_t*		mutex;
+	uint32_t		head;
+	uint32_t		tail;
+} cli_queue_t;
+
+typedef struct cli_batch_t cli_batch_t;
+
+typedef struct
+{
+	cli_batch_t*	batch;
+	cli_queue_t		queue;
+	thread_t*		thread;
+	int				index;
+} cli_worker_t;
+
+struct cli_batch_t
+{
+	config_t*		config;
+	game_data_t*	data;
+	cli_job_t*		jobs;
+	uint32_t*		order;
+	uint32_t		job_count;
+	uint32_t		print_idx;
+	mutex_t*		print_mutex;
+	FILE*			text_file;
+	FILE*			report_file;
+	uint32_t		report_count;
+	FILE*			diagnose_file;
+	uint32_t		diagnose_count;
+	cli_worker_t*	workers;
+	int				worker_count;
+	loader_t		loader;
+};
+
+bool main_cli_queue_pop(cli_queue_t* queue, bool steal, uint32_t* idx)
+{
+	bool ret = false;
+
+	mutex_lock(queue->mutex);
+	if (queue->head < queue->tail)
+	{
+		*idx = steal ? --queue->tail : queue->head++;
+		ret = true;
+	}
+	mutex_unlock(queue->mutex);
+
+	return ret;
+}
+
+bool main_cli_next_job(cli_worker_t* worker, uint32_t* idx)
+{
+	if (main_cli_queue_pop(&worker->queue, false, idx))
+		return true;
+
+	cli_batch_t* batch = worker->batch;
+	for (int i = 1; i < batch->worker_count; i++)
+	{
+		cli_worker_t* victim = &batch->workers[(worker->index + i) % batch->worker_count];
+		if (main_cli_queue_pop(&victim->queue, true, idx))
+			return true;
+	}
+
+	return false;
+}
+
+void main_cli_write_record(FILE* file, uint32_t* count, strbuf_t* record, const char* separator)
+{
+	if (file && record->size > 0)
+	{
+		fputs((*count)++ ? separator : "", file);
+		strbuf_flush(record, file);
+	}
+	strbuf_free(record);
+}
+
+void main_cli_finish_job(cli_batch_t* batch, cli_job_t* job)
+{
+	mutex_lock(batch->print_mutex);
+
+	job->done = true;
+	while (batch->print_idx < batch->job_count && batch->jobs[batch->print_idx].done)
+	{
+		cli_job_t* next = &batch->jobs[batch->print_idx++];
+		strbuf_flush(&next->output, batch->text_file);
+		strbuf_free(&next->output);
+
+		main_cli_write_record(batch->report_file, &batch->report_count, &next->report, report_separator(batch->config->report_format));
+		main_cli_write_record(batch->diagnose_file, &batch->diagnose_count, &next->diagnosis, ",\n");
+	}
+
+	mutex_unlock(batch->print_mutex);
+}
+
+int main_cli_worker(void* userdata)
+{
+	cli_worker_t* worker = userdata;
+	cli_batch_t* batch = worker->batch;
+
+	/* denormal mode is per thread */
+	_MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+
+	game_t game;
+	game_init(&game, batch->data);
+	game.check = batch->config->check;
+
+	uint32_t idx;
+	while (main_cli_next_job(worker, &idx))
+	{
+		cli_job_t* job = &batch->jobs[batch->order[idx]];
+
+		game.output = &job->output;
+		main_cli_run_ghost(&game, batch->config, &batch->loader, batch->order[idx], 
+			batch->report_file ? &job->report : NULL, 
+			batch->diagnose_file ? &job->diagnosis : NULL);
+		game.output = NULL;
+
+		main_cli_finish_job(batch, job);
+	}
+
+	game_free(&game);
+	return 0;
+}
+
+int main_cli_compare_keys(const void* a, const void* b)
+{
+	uint64_t key_a = *(const uint64_t*)a;
+	uint64_t key_b = *(const uint64_t*)b;
+	return (key_a > key_b) - (key_a < key_b);
+}
+
+/*
+* Group the run order by course, then vehicle and character, so the shared course
+* and vehicle data stay hot while a group runs. Output still follows input order
+*/
+void main_cli_sort_jobs(cli_batch_t* batch)
+{
+	uint64_t* keys = malloc(batch->job_count * sizeof(*keys));
+
+	for (uint32_t i = 0; i < batch->job_count; i++)
+	{
+		rkg_header_t header;
+		uint64_t group = UINT32_MAX;
+
+		/* unreadable ghosts go last, loading them again reports the error */
+		if (rkg_read_header(&header, batch->jobs[i].path))
+			group = (uint64_t)header.course_id << 16 | (uint64_t)header.vehicle_id << 8 | header.character_id;
+
+		keys[i] = group << 32 | i;
+	}
+
+	qsort(keys, batch->job_count, sizeof(*keys), main_cli_compare_keys);
+
+	for (uint32_t i = 0; i < batch->job_count; i++)
+		batch->order[i] = (uint32_t)keys[i];
+
+	free(keys);
+}
+
+int main_cli_run_batch(cli_batch_t* batch)
+{
+	int ret = 0;
+
+	int worker_count = batch->config->jobs;
+	if (worker_count <= 0)
+		worker_count = thread_cpu_count();
+	if ((uint32_t)worker_count > batch->job_count)
+		worker_count = (int)batch->job_count;
+	if (worker_count < 1)
+		worker_count = 1;
+
+	batch->order = malloc(batch->job_count * sizeof(*batch->order));
+	main_cli_sort_jobs(batch);
+
+	batch->print_idx = 0;
+	batch->print_mutex = mutex_create();
+	batch->worker_count = worker_count;
+	batch->workers = malloc(worker_count * sizeof(*batch->workers));
+
+	for (int i = 0; i < worker_count; i++)
+	{
+		cli_worker_t* worker = &batch->workers[i];
+		worker->batch = batch;
+		worker->index = i;
+		worker->thread = NULL;
+		worker->queue.mutex = mutex_create();
+		worker->queue.head = (uint32_t)((uint64_t)batch->job_count * i / worker_count);
+		worker->queue.tail = (uint32_t)((uint64_t)batch->job_count * (i + 1) / worker_count);
+	}
+
+	loader_t* loader = &batch->loader;
+	loader_init(loader, batch->data, batch->config->course_path, batch->job_count, (uint32_t)max(batch->config->preload, 0));
+	for (uint32_t i = 0; i < batch->job_count; i++)
+		loader->ghosts[i].path = batch->jobs[i].path;
+
+	/* read ahead in the order workers reach their jobs, every worker's next job first */
+	uint32_t loader_idx = 0;
+	for (uint32_t step = 0; loader_idx < batch->job_count; step++)
+	{
+		for (int i = 0; i < worker_count; i++)
+		{
+			cli_queue_t* queue = &batch->workers[i].queue;
+			if (queue->head + step < queue->tail)
+				loader->order[loader_idx++] = batch->order[queue->head + step];
+		}
+	}
+
+	loader_start(loader, loader_max_threads);
+
+	/* Common.szs decompresses here while the loader already reads courses and ghosts */
+	if (!game_data_load(batch->data, batch->config->common_path))
+		goto cleanup;
+
+	/* the calling thread doubles as the first worker */
+	for (int i = 1; i < worker_count; i++)
+		batch->workers[i].thread = thread_create(main_cli_worker, &batch->workers[i]);
+
+	main_cli_worker(&batch->workers[0]);
+
+	for (int i = 1; i < worker_count; i++)
+	{
+		if (batch->workers[i].thread)
+			thread_join(batch->workers[i].thread);
+	}
+
+	ret = 1;
+
+cleanup:
+	loader_free(loader);
+
+	for (int i = 0; i < worker_count; i++)
+		mutex_free(batch->workers[i].queue.mutex);
+
+	free(batch->workers);
+	free(batch->order);
+	mutex_free(batch->print_mutex);
+	return ret;
+}
+
+void main_cli_add_job(cli_batch_t* batch, uint32_t* capacity, const char* path)
+{
+	if (batch->job_count >= *capacity)
+	{
+		*capacity = *capacity ? *capacity * 2 : 64;
+		batch->jobs = realloc(batch->jobs, *capacity * sizeof(*batch->jobs));
+	}
+
+	cli_job_t* job = &batch->jobs[batch->job_count++];
+	job->path = malloc(strlen(path) + 1);
+	strcpy(job->path, path);
+	strbuf_init(&job->output);
+	strbuf_init(&job->report);
+	strbuf_init(&job->diagnosis);
+	job->done = false;
+}
+
+int main_cli(game_data_t* data, config_t* config)
 {
 	uint64_t start_time = SDL_GetPerformanceCounter();
 
+	cli_batch_t batch;
+	batch.config = config;
+	batch.data = data;
+	batch.jobs = NULL;
+	batch.job_count = 0;
+	batch.text_file = stdout;
+	batch.report_file = NULL;
+	batch.report_count = 0;
+	batch.diagnose_file = NULL;
+	batch.diagnose_count = 0;
+	uint32_t job_capacity = 0;
+
+	/*
+		records on stdout push the prose over to stderr. so do the errors printed
+		while loading, from loader threads too, by pointing stdout itself at stderr
+		and keeping the original only for the records
+	*/
+	if (config->report_format != report_none)
+	{
+		if (config->report_path)
+		{
+			batch.report_file = fopen(config->report_path, "w");
+			if (!batch.report_file)
+			{
+				printf("Failed to open %s for writing\n", config->report_path);
+				return 1;
+			}
+		}
+		else
+		{
+			fflush(stdout);
+			int records = dup(fileno(stdout));
+			batch.report_file = records >= 0 ? fdopen(records, "w") : NULL;
+			if (!batch.report_file || dup2(fileno(stderr), fileno(stdout)) < 0)
+			{
+				printf("Failed to redirect stdout\n");
+				return 1;
+			}
+			batch.text_file = stderr;
+		}
+		fputs(report_begin(config->report_format), batch.report_file);
+	}
+
+	if (config->diagnose_path)
+	{
+		batch.diagnose_file = fopen(config->diagnose_path, "w");
+		if (!batch.diagnose_file)
+		{
+			printf("Failed to open %s for writing\n", config->diagnose_path);
+			return 1;
+		}
+		fprintf(batch.diagnose_file, "[\n");
+	}
+
 	tinydir_dir dir;
 	tinydir_open(&dir, config->ghost_path);
 
@@ -142,26 +659,256 @@ int main_cli(game_t* game, config_t* config)
 			tinydir_readfile(&dir, &file);
 
 			if (!stricmp(file.extension, "rkg"))
-				main_cli_run_ghost(game, config, file.path);
+				main_cli_add_job(&batch, &job_capacity, file.path);
 
 			tinydir_next(&dir);
 		}
 	}
 	else
 	{
-		main_cli_run_ghost(game, config, config->ghost_path);
+		main_cli_add_job(&batch, &job_capacity, config->ghost_path);
+	}
+
+	int ret = main_cli_run_batch(&batch) ? 0 : 1;
+
+	if (batch.report_file)
+	{
+		fputs(report_end(config->report_format), batch.report_file);
+		fclose(batch.report_file);
 	}
 
+	if (batch.diagnose_file)
+	{
+		fprintf(batch.diagnose_file, "\n]\n");
+		fclose(batch.diagnose_file);
+		fprintf(batch.text_file, "Diagnosed %u desync(s) in %s\n", batch.diagnose_count, config->diagnose_path);
+	}
+
+	for (uint32_t i = 0; i < batch.job_count; i++)
+		free(batch.jobs[i].path);
+	free(batch.jobs);
+
 	double elapsed_time = (SDL_GetPerformanceCounter() - start_time) / (double)SDL_GetPerformanceFrequency();
-	printf("Completed in %.2f seconds\n", elapsed_time);
+	fprintf(batch.text_file, "Completed in %.2f seconds\n", elapsed_time);
 
 	tinydir_close(&dir);
-	return 0;
+	return ret;
+}
+
+int main_build_cache(const char* course_dir)
+{
+	int built = 0;
+	for (int i = 0; i < course_max_id; i++)
+	{
+		if (course_bin_build(course_dir, (uint8_t)i))
+		{
+			printf("Built %s\n", course_name_by_id((uint8_t)i));
+			built++;
+		}
+	}
+
+	printf("Built %d course(s) in %s\n", built, course_dir);
+	return built > 0 ? 0 : 1;
+}
+
+int main_pack_traces(const char* ghost_path)
+{
+	int packed = 0;
+	int failed = 0;
+
+	tinydir_dir dir;
+	tinydir_open(&dir, ghost_path);
+
+	if (dir.has_next)
+	{
+		while (dir.has_next)
+		{
+			tinydir_file file;
+			tinydir_readfile(&dir, &file);
+
+			if (!stricmp(file.extension, "rkrd"))
+			{
+				if (rkrz_build(file.path))
+					packed++;
+				else
+					failed++;
+			}
+
+			tinydir_next(&dir);
+		}
+	}
+	else
+	{
+		if (rkrz_build(ghost_path))
+			packed++;
+		else
+			failed++;
+	}
+
+	tinydir_close(&dir);
+
+	printf("Packed %d trace(s), %d failed\n", packed, failed);
+	return packed > 0 && failed == 0 ? 0 : 1;
+}
+
+int main_bench_load(const char* course_dir, int iterations)
+{
+	int loaded = 0;
+	double total_time = 0.0;
+
+	for (int i = 0; i < course_max_id; i++)
+	{
+		const char* course_name = course_name_by_id((uint8_t)i);
+		if (!course_name[0])
+			continue;
+
+		char course_path[_MAX_PATH];
+		sprintf(course_path, "%s/%s.szs", course_dir, course_name);
+
+		bin_t buffer;
+		if (!bin_read(&buffer, course_path))
+			continue;
+
+		/* time parsing only, the file is read once up front */
+		uint64_t start_time = SDL_GetPerformanceCounter();
+		int j;
+		for (j = 0; j < iterations; j++)
+		{
+			course_t course;
+			course_parser.init(&course);
+			if (!course_parser.parse(&course, &buffer))
+				break;
+			course_parser.free(&course);
+		}
+
+		double elapsed_time = (SDL_GetPerformanceCounter() - start_time) / (double)SDL_GetPerformanceFrequency();
+		bin_free(&buffer);
+
+		if (j != iterations)
+		{
+			printf("Failed to parse %s\n", course_path);
+			continue;
+		}
+
+		printf("%-24s %8.3f ms\n", course_name, elapsed_time * 1000.0 / iterations);
+		total_time += elapsed_time;
+		loaded++;
+	}
+
+	printf("Loaded %d course(s) %d time(s) in %.3f seconds\n", loaded, iterations, total_time);
+	return loaded > 0 ? 0 : 1;
+}
+
+/* MB/s of decompressed output for both Yaz0 decoders, the outputs must match */
+int main_bench_yaz_file(const char* path, int iterations, double* fast_time, double* reference_time, size_t* total_size)
+{
+	bin_t buffer;
+	if (!bin_read(&buffer, path))
+		return 0;
+
+	if (!yaz_is_compressed(&buffer))
+	{
+		bin_free(&buffer);
+		return 0;
+	}
+
+	bin_t fast;
+	double times[2] = { 0.0, 0.0 };
+	bool ok = yaz_decompress(&buffer, &fast) == YAZ_OK;
+	if (!ok)
+		printf("Failed to decompress %s\n", path);
+
+	for (int j = 0; j < iterations && ok; j++)
+	{
+		bin_t output;
+		uint64_t start_time = SDL_GetPerformanceCounter();
+		yaz_decompress(&buffer, &output);
+		times[0] += (SDL_GetPerformanceCounter() - start_time) / (double)SDL_GetPerformanceFrequency();
+		bin_free(&output);
+
+		start_time = SDL_GetPerformanceCounter();
+		yaz_decompress_reference(&buffer, &output);
+		times[1] += (SDL_GetPerformanceCounter() - start_time) / (double)SDL_GetPerformanceFrequency();
+
+		if (j == 0 && (output.size != fast.size || memcmp(output.buffer, fast.buffer, fast.size)))
+		{
+			printf("Decoders disagree on %s\n", path);
+			ok = false;
+		}
+		bin_free(&output);
+	}
+
+	if (ok)
+	{
+		double megabytes = fast.size * (double)iterations / (1024.0 * 1024.0);
+		printf("%-40s %8.1f MB/s %8.1f MB/s\n", path, megabytes / times[0], megabytes / times[1]);
+
+		*fast_time += times[0];
+		*reference_time += times[1];
+		*total_size += fast.size * (size_t)iterations;
+	}
+
+	bin_free(&fast);
+	bin_free(&buffer);
+	return ok;
+}
+
+int main_bench_yaz(const char* path, int iterations)
+{
+	int benched = 0;
+	double fast_time = 0.0, reference_time = 0.0;
+	size_t total_size = 0;
+
+	printf("%-40s %13s %13s\n", "File", "Decoder", "Reference");
+
+	tinydir_dir dir;
+	tinydir_open(&dir, path);
+
+	if (dir.has_next)
+	{
+		while (dir.has_next)
+		{
+			tinydir_file file;
+			tinydir_readfile(&dir, &file);
+
+			if (!stricmp(file.extension, "szs"))
+				benched += main_bench_yaz_file(file.path, iterations, &fast_time, &reference_time, &total_size);
+
+			tinydir_next(&dir);
+		}
+	}
+	else
+	{
+		benched += main_bench_yaz_file(path, iterations, &fast_time, &reference_time, &total_size);
+	}
+
+	tinydir_close(&dir);
+
+	if (benched > 0)
+	{
+		double megabytes = total_size / (1024.0 * 1024.0);
+		printf("%-40s %8.1f MB/s %8.1f MB/s\n", "Total", megabytes / fast_time, megabytes / reference_time);
+	}
+
+	printf("Decompressed %d file(s) %d time(s)\n", benched, iterations);
+	return benched > 0 ? 0 : 1;
 }
 
 int main(int argc, char* argv[])
 {
 	int ret = 1;
+	if (argc == 3 && !strcmp(argv[1], "-build-cache"))
+		return main_build_cache(argv[2]);
+
+	if ((argc == 3 || argc == 4) && !strcmp(argv[1], "-bench-yaz"))
+		return main_bench_yaz(argv[2], argc == 4 ? max(atoi(argv[3]), 1) : 10);
+
+	if (argc == 3 && !strcmp(argv[1], "-pack-traces"))
+		return main_pack_traces(argv[2]);
+
+	if ((argc == 3 || argc == 4) && !strcmp(argv[1], "-bench-load"))
+		return main_bench_load(argv[2], argc == 4 ? max(atoi(argv[3]), 1) : 10);
+
 	if (argc < 4)
 	{
 		printf(
@@ -174,8 +921,28 @@ int main(int argc, char* argv[])
 			" -width          <int>     |    800    | Screen width\n"
 			" -height         <int>     |    600    | Screen height\n"
 			" -start          <int>     |    0      | Starting frame to simulate from\n"
+			" -snap-interval  <int>     |    120    | Frames between seek snapshots\n"
+			" -save-snapshots           |    off    | Write seek snapshots to <ghost>.snap\n"
+			" -jobs           <int>     |    1      | Worker threads for -cli, 0 for all cores\n"
+			" -course-cache   <int>     |    0      | Max courses kept loaded, 0 for no limit\n"
+			" -preload        <int>     |    8      | Ghosts and courses read ahead for -cli, 0 for off\n"
+			" -stats                    |    off    | Print collision statistics for -cli\n"
+			" -diagnose       <file>    |    off    | Write a JSON report of each desync for -cli\n"
+			" -report         <format>  |    off    | One json or csv record per ghost for -cli\n"
+			" -report-file    <file>    |   stdout  | Where -report records go\n"
+			" -check          <policy>  |   strict  | strict-stop, strict-continue, ulp:<n>, fields:<a,b>\n"
 			"---------------------------+-----------+--------------------------------------\n"
-			"example: hanachanc Common.szs Course samples/bc64-rta-0-i.rkg -pause\n"
+			"example: hanachanc Common.szs Course samples/bc64-rta-0-i.rkg -pause\n\n"
+			"usage: hanachanc -build-cache <course(s)>\n"
+			"  Precompile every course to a .hcb file beside it, later runs map those\n"
+			"  instead of parsing. A course changed since is parsed again until rebuilt\n\n"
+			"usage: hanachanc -pack-traces <ghost(s)>\n"
+			"  Pack every .rkrd to a smaller .rkrz beside it. The .rkrd is still read\n"
+			"  while it exists since it decodes faster, so it can be archived after\n\n"
+			"usage: hanachanc -bench-load <course(s)> [iterations]\n"
+			"  Time parsing every course, 10 iterations by default\n\n"
+			"usage: hanachanc -bench-yaz <szs(s)> [iterations]\n"
+			"  Yaz0 decompression speed against the reference decoder, 10 iterations by default\n"
 		);
 		printf("\nPress a key to continue...\n");
 		getchar();
@@ -199,6 +966,10 @@ int main(int argc, char* argv[])
 			{
 				config.cli = true;
 			}
+			else if (!strcmp(argv[i], "-stats"))
+			{
+				config.stats = true;
+			}
 			else if (!strcmp(argv[i], "-pause"))
 			{
 				config.start_paused = true;
@@ -243,6 +1014,99 @@ int main(int argc, char* argv[])
 
 				config.frame_start = (uint32_t)atoi(argv[++i]);
 			}
+			else if (!strcmp(argv[i], "-snap-interval"))
+			{
+				if (argc <= i + 1)
+				{
+					printf("Missing parameter for -snap-interval\n");
+					return ret;
+				}
+
+				config.seek_interval = (uint32_t)max(atoi(argv[++i]), 1);
+			}
+			else if (!strcmp(argv[i], "-save-snapshots"))
+			{
+				config.save_snapshots = true;
+			}
+			else if (!strcmp(argv[i], "-diagnose"))
+			{
+				if (argc <= i + 1)
+				{
+					printf("Missing parameter for -diagnose\n");
+					return ret;
+				}
+
+				config.diagnose_path = argv[++i];
+			}
+			else if (!strcmp(argv[i], "-report"))
+			{
+				if (argc <= i + 1)
+				{
+					printf("Missing parameter for -report\n");
+					return ret;
+				}
+
+				config.report_format = report_format_by_name(argv[++i]);
+				if (config.report_format == report_none)
+				{
+					printf("Unknown report format %s, expected json or csv\n", argv[i]);
+					return ret;
+				}
+			}
+			else if (!strcmp(argv[i], "-report-file"))
+			{
+				if (argc <= i + 1)
+				{
+					printf("Missing parameter for -report-file\n");
+					return ret;
+				}
+
+				config.report_path = argv[++i];
+			}
+			else if (!strcmp(argv[i], "-check"))
+			{
+				if (argc <= i + 1)
+				{
+					printf("Missing parameter for -check\n");
+					return ret;
+				}
+
+				if (!rkrd_check_parse(&config.check, argv[++i]))
+				{
+					printf("Unknown check policy %s\n", argv[i]);
+					return ret;
+				}
+			}
+			else if (!strcmp(argv[i], "-jobs"))
+			{
+				if (argc <= i + 1)
+				{
+					printf("Missing parameter for -jobs\n");
+					return ret;
+				}
+
+				config.jobs = atoi(argv[++i]);
+			}
+			else if (!strcmp(argv[i], "-course-cache"))
+			{
+				if (argc <= i + 1)
+				{
+					printf("Missing parameter for -course-cache\n");
+					return ret;
+				}
+
+				config.course_cache = atoi(argv[++i]);
+			}
+			else if (!strcmp(argv[i], "-preload"))
+			{
+				if (argc <= i + 1)
+				{
+					printf("Missing parameter for -preload\n");
+					return ret;
+				}
+
+				config.preload = atoi(argv[++i]);
+			}
 			else
 			{
 				printf("Unknown parameter %s\n", argv[i]);
@@ -259,13 +1123,18 @@ int main(int argc, char* argv[])
 		}
 	}
 
-	game_t game;
-	game_init(&game);
-	game.pause = config.start_paused;
+	game_data_t data;
+	game_data_init(&data, config.course_cache);
 
-	if (!game_load(&game, config.common_path))
+	/* -cli loads Common.szs itself, alongside its first courses and ghosts */
+	if (!config.cli && !game_data_load(&data, config.common_path))
 		return ret;
 
+	game_t game;
+	game_init(&game, &data);
+	game.pause = config.start_paused;
+	game.check = config.check;
+
 	SDL_Window* window = NULL;
 	SDL_GLContext context = NULL;
 	graphics_t graphics;
@@ -281,18 +1150,20 @@ int main(int argc, char* argv[])
 		if (!graphics_init(&graphics, window, config.width, config.height))
 		{
 			game_free(&game);
+			game_data_free(&data);
 			return ret;
 		}
-		game.graphics = &graphics;
 
-		main_graphics(&game, &config);
+		main_graphics(&game, &graphics, &config);
+		ret = 0;
 	}
 	else
 	{
-		main_cli(&game, &config);
+		ret = main_cli(&data, &config);
 	}
 
 	game_free(&game);
+	game_data_free(&data);
 
 	if (!config.cli)
 	{
@@ -303,5 +1174,5 @@ int main(int argc, char* argv[])
 	}
 
 	SDL_Quit();
-	return 0;
+	return ret;
 }
\ No newline at end of file
@@ -51,7 +51,7 @@ void drift_hop_update_physics(drift_hop_t* hop)
 void drift_normal_start(drift_normal_t* drift, vehicle_t* vehicle, float stick_x)
 {
 	if (vehicle->drift.has_outside_drift)
-		vehicle->drift.outside.bonus = vehicle->physics.speed1_ratio * vehicle->stats.drift_tightness_manual * 0.5f;
+		vehicle->drift.outside.bonus = vehicle->physics.speed1_ratio * vehicle->stats->drift_tightness_manual * 0.5f;
 
 	drift->stick_x        = stick_x;
 	drift->mt_charge      = 0;
@@ -226,7 +226,7 @@ void drift_update(drift_t* drift, vehicle_t* vehicle, float stick_x, bool drift_
 	{
 		if (drift->has_outside_drift)
 		{
-			float dec = vehicle->stats.drift_decrement;
+			float dec = vehicle->stats->drift_decrement;
 			float angle = drift->outside.angle;
 			drift->outside.angle = copysignf(1.0f, angle) * fmaxf(fabsf(angle) - dec, 0.0f);
 		}
@@ -242,10 +242,10 @@ void drift_update(drift_t* drift, vehicle_t* vehicle, float stick_x, bool drift_
 				if (drift->has_outside_drift)
 				{
 					float last_angle = drift->outside.angle * drift->drift.stick_x;
-					float target_angle = vehicle->stats.drift_target_angle;
+					float target_angle = vehicle->stats->drift_target_angle;
 					float next_angle;
 					if (last_angle < target_angle)
-						next_angle = fminf(last_angle + 150.0f * vehicle->stats.drift_tightness_manual, target_angle);
+						next_angle = fminf(last_angle + 150.0f * vehicle->stats->drift_tightness_manual, target_angle);
 					else if (last_angle > target_angle)
 						next_angle = fmaxf(last_angle - 2.0f, target_angle);
 					else
@@ -259,7 +259,7 @@ void drift_update(drift_t* drift, vehicle_t* vehicle, float stick_x, bool drift_
 		}
 		else
 		{
-			drift_normal_release_miniturbo(&drift->drift, &vehicle->boost, (uint16_t)vehicle->stats.mini_turbo_duration);
+			drift_normal_release_miniturbo(&drift->drift, &vehicle->boost, (uint16_t)vehicle->stats->mini_turbo_duration);
 			drift->state = drift_idle;
 		}
 	}
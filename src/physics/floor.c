@@ -73,8 +73,8 @@ void floor_update_factors(floor_t* floor, vehicle_t* vehicle)
 	/* TODO: does -1.0f make more sense here? */
 	if (floor->invincibility > 0)
 	{
-		floor->speed_factor    = vehicle->stats.speed_multipliers[0];
-		floor->rotation_factor = vehicle->stats.rotation_multipliers[0];
+		floor->speed_factor    = vehicle->stats->speed_multipliers[0];
+		floor->rotation_factor = vehicle->stats->rotation_multipliers[0];
 	}
 	else
 	{
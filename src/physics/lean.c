@@ -39,6 +39,22 @@ void lean_set_drift(lean_t* lean, bool inside_drift)
     lean->params   = inside_drift ? &params_inside_drift : &params_outside_drift;
 }
 
+/* params as an index for snapshots, -1 when not set yet, otherwise inside_drift */
+int lean_get_params(lean_t* lean)
+{
+    if (!lean->params)
+        return -1;
+    return lean->params == &params_inside_drift;
+}
+
+void lean_set_params(lean_t* lean, int params)
+{
+    if (params < 0)
+        lean->params = NULL;
+    else
+        lean_set_drift(lean, params != 0);
+}
+
 void lean_update(lean_t* lean, vehicle_t* vehicle, float stick_x, int stage)
 {   
     lean_params_t* params = lean->params;
@@ -27,4 +27,6 @@ typedef struct
 
 void lean_init(lean_t* lean);
 void lean_set_drift(lean_t* lean, bool inside_drift);
+int  lean_get_params(lean_t* lean);
+void lean_set_params(lean_t* lean, int params);
 void lean_update(lean_t* lean, vehicle_t* vehicle, float stick_x, int stage);
\ No newline at end of file
@@ -363,7 +363,7 @@ void physics_update_dirs(physics_t* physics, vehicle_t* vehicle)
 
 void physics_update_accel(physics_t* physics, vehicle_t* vehicle, input_t* input, int stage)
 {
-    param_section_t* stats = &vehicle->stats;
+    const param_section_t* stats = vehicle->stats;
     boost_t* boost = &vehicle->boost;
     floor_t* floor = &vehicle->floor;
 
@@ -492,7 +492,7 @@ void physics_update_accel(physics_t* physics, vehicle_t* vehicle, input_t* input
     if (jump_pad_speed != 0.0f)
         physics->speed1 = fmaxf(physics->speed1, jump_pad_speed);
 
-    physics->speed1_ratio = fminf(fabsf(physics->speed1 / vehicle->stats.speed), 1.0f);
+    physics->speed1_ratio = fminf(fabsf(physics->speed1 / vehicle->stats->speed), 1.0f);
 
     vec3_t right;
     vec3_cross(&physics->smoothed_up, &physics->dir, &right);
@@ -649,13 +649,13 @@ void physics_update_landing_angle(physics_t* physics)
 
 float physics_calc_acceleration(physics_t* physics, vehicle_t* vehicle)
 {
-    param_section_t* stats = &vehicle->stats;
+    const param_section_t* stats = vehicle->stats;
 
     float acceleration;
     float t = physics->speed1 / physics->speed1_soft_limit;
     if (t >= 0.0f)
     {
-        float *ys, *xs;
+        const float *ys, *xs;
         int i, len;
         acceleration = 0.0f;
 
@@ -60,7 +60,7 @@ void trick_try_start(trick_t* trick, vehicle_t* vehicle)
 
 	if (vehicle->jump_pad.variant == variant_invalid)
 	{
-		int32_t weight_class = vehicle->stats.weight_class;
+		int32_t weight_class = vehicle->stats->weight_class;
 
 		vec3_t cross;
 		vec3_cross(&physics->vel1_dir, &vec3_up, &cross);
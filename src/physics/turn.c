@@ -19,9 +19,9 @@ void turn_update(turn_t* turn, vehicle_t* vehicle, float stick_x)
 
 	float reactivity;
 	if (vehicle->drift.state == drift_normal)
-		reactivity = vehicle->stats.drift_reactivity;
+		reactivity = vehicle->stats->drift_reactivity;
 	else
-		reactivity = vehicle->stats.handling_reactivity;
+		reactivity = vehicle->stats->handling_reactivity;
 
 	turn->raw = (1.0f - reactivity) * turn->raw + reactivity * -stick_x;
 
@@ -46,9 +46,9 @@ void turn_update_rot(turn_t* turn, vehicle_t* vehicle, input_t* input)
 	if (!vehicle->standstill_miniturbo.charging)
 	{
 		if (vehicle->drift.state == drift_normal)
-			rot = turn->drift * (vehicle->stats.drift_tightness_manual + vehicle->drift.outside.bonus);
+			rot = turn->drift * (vehicle->stats->drift_tightness_manual + vehicle->drift.outside.bonus);
 		else
-			rot = turn->drift * vehicle->stats.handling_tightness_manual;
+			rot = turn->drift * vehicle->stats->handling_tightness_manual;
 
 		if (vehicle->drift.state == drift_hop && vehicle->drift.hop.pos_y > 0.0f)
 			rot *= 1.4f;
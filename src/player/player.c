@@ -6,25 +6,24 @@
 #include "../fs/param.h"
 #include "../course/course.h"
 #include "../game/game.h"
+#include "../game/diagnose.h"
 
 #include "../vehicle/vehicle.h"
 #include "../physics/physics.h"
 
-#include "../graphics/graphics.h"
-
 void player_init(player_t* player)
 {
 	player->vehicle = NULL;
 	memset(&player->input, 0, sizeof(player->input));
 	memset(&player->input_last, 0, sizeof(player->input_last));
-	memset(&player->last_key_state, 0, sizeof(player->last_key_state));
-	player->freecam = false;
 }
 
+/* the player and its vehicle are owned by the game arena */
 void player_free(player_t* player)
 {
+	if (player->vehicle)
+		vehicle_free(player->vehicle);
 	player->vehicle = NULL;
-	free(player);
 }
 
 int player_load_ghost(player_t* player, game_t* game, rkg_t* rkg)
@@ -35,9 +34,8 @@ int player_load_ghost(player_t* player, game_t* game, rkg_t* rkg)
 	if (!vehicle)
 		return 0;
 
-	vehicle_place(vehicle, &game->course);
-	game_add_player(game, player);
-	return 1;
+	vehicle_place(vehicle, game->course);
+	return game_add_player(game, player);
 }	
 
 void player_update(player_t* player, game_t* game)
@@ -48,13 +46,16 @@ void player_update(player_t* player, game_t* game)
 	floor_t*   floor		       = &vehicle->floor;
 	trick_t*   trick			   = &vehicle->trick;
 	surface_props_t* surface_props = &vehicle->surface_props;
-	kcl_t*	   kcl				   = &game->course.kcl;
+	kcl_t*	   kcl				   = &game->course->kcl;
 	bool	   is_bike			   = vehicle_is_bike(vehicle);
+	diagnose_t* diagnose		   = player == game->players[0] ? game->diagnose : NULL;
 
 	int stage = game_get_stage(game); /* TODO: shouldnt this be stored off in game? */
 
 	physics->rot_vec2 = vec3_zero;
 
+	DIAGNOSE_CHECKPOINT(diagnose, diagnose_stage_start, physics);
+
 	floor_update(floor, vehicle);
 
 	if (floor->airtime == 0)
@@ -99,13 +100,19 @@ void player_update(player_t* player, game_t* game)
 
 	floor_update_factors(floor, vehicle);
 
+	DIAGNOSE_CHECKPOINT(diagnose, diagnose_stage_floor, physics);
+
 	turn_update(&vehicle->turn, vehicle, input->stick_x);
 
+	DIAGNOSE_CHECKPOINT(diagnose, diagnose_stage_turn, physics);
+
 	drift_update(&vehicle->drift, vehicle, input->stick_x, input->drift && stage == stage_race, player->input_last.drift);
 
 	if (is_bike)
 		wheelie_update(&vehicle->wheelie, vehicle, input->trick);
 
+	DIAGNOSE_CHECKPOINT(diagnose, diagnose_stage_drift, physics);
+
 	standstill_miniturbo_update(&vehicle->standstill_miniturbo, vehicle);
 
 	boost_update(&vehicle->boost);
@@ -117,6 +124,8 @@ void player_update(player_t* player, game_t* game)
 
 	physics_update_accel(physics, vehicle, input, stage);
 
+	DIAGNOSE_CHECKPOINT(diagnose, diagnose_stage_accel, physics);
+
 	standstill_boost_update(&vehicle->standstill_boost, vehicle, stage);
 
 	if (is_bike)
@@ -154,7 +163,7 @@ void player_update(player_t* player, game_t* game)
 			physics->rot_vec0.z *= 0.98f;
 		}
 
-		physics->rot_vec0.z += vehicle->stats.tilt * norm * fabsf(vehicle->turn.raw);
+		physics->rot_vec0.z += vehicle->stats->tilt * norm * fabsf(vehicle->turn.raw);
 	}
 
 	turn_update_rot(&vehicle->turn, vehicle, input);
@@ -167,12 +176,18 @@ void player_update(player_t* player, game_t* game)
 
 	dive_update(&vehicle->dive, vehicle, stick_y);
 
+	DIAGNOSE_CHECKPOINT(diagnose, diagnose_stage_rotation, physics);
+
 	physics_update(physics, vehicle, stage);
 
+	DIAGNOSE_CHECKPOINT(diagnose, diagnose_stage_physics, physics);
+
 	surface_props_reset(surface_props);
 
 	vehicle_body_update(&vehicle->body, vehicle, kcl);
 
+	DIAGNOSE_CHECKPOINT(diagnose, diagnose_stage_body, physics);
+
 	int count = 0;
 	vec3_t min = vec3_zero;
 	vec3_t max = vec3_zero;
@@ -181,11 +196,22 @@ void player_update(player_t* player, game_t* game)
 	vec3_t floor_nor = vec3_zero;
 	vec3_t movement, temp;
 
+	/* wheel hitboxes don't depend on each other's collisions, query them together */
+	hitbox_t* wheel_hitboxes[bsp_max_wheels];
+	collision_t wheel_collisions[bsp_max_wheels];
+	for (int i = 0; i < vehicle->wheel_count; i++)
+	{
+		vehicle_wheel_update_hitbox(&vehicle->wheels[i], vehicle);
+		wheel_hitboxes[i] = &vehicle->wheels[i].hitbox;
+	}
+
+	kcl_collision_hitboxes(kcl, wheel_hitboxes, vehicle->wheel_count, wheel_collisions);
+
 	for (int i = 0; i < vehicle->wheel_count; i++)
 	{
 		vehicle_wheel_t* wheel = &vehicle->wheels[i];
 
-		if (vehicle_wheel_update(wheel, vehicle, kcl, &movement))
+		if (vehicle_wheel_update(wheel, vehicle, &wheel_collisions[i], &movement))
 		{
 			vec3_min(&min, &movement, &min);
 			vec3_max(&max, &movement, &max);
@@ -215,6 +241,8 @@ void player_update(player_t* player, game_t* game)
 		vehicle_collision_set_normal(&vehicle->body.collision, &floor_nor);
 	}
 
+	DIAGNOSE_CHECKPOINT(diagnose, diagnose_stage_wheels, physics);
+
 	for (int i = 0; i < vehicle->wheel_count; i++)
 	{
 		vehicle_wheel_t* wheel = &vehicle->wheels[i];
@@ -225,45 +253,14 @@ void player_update(player_t* player, game_t* game)
 
 	mat34_init_quat_pos(&physics->mat, &physics->full_rot, &physics->pos);
 
+	DIAGNOSE_CHECKPOINT(diagnose, diagnose_stage_suspension, physics);
+
 	if (player->input.use_item && !player->input_last.use_item)
 	{
 		boost_activate(&vehicle->boost, boost_strong, 90);
 		floor_activate_invincibility(floor, 90);
 		vehicle->boost.mushroom_boost = 90;
 	}
-	
-	if (!player->freecam && game->graphics)
-	{
-		camera_t* camera = &game->graphics->camera;
-
-		vec3_t camera_target_pos;
-		vec3_muladd(&physics->pos, 200.0f, &vec3_up, &camera_target_pos);
-		vec3_muladd(&camera_target_pos, -400.0f, &physics->dir, &camera_target_pos);
-		vec3_mul(&camera_target_pos, -1.0f, &camera_target_pos);
 
-		vec3_t camera_dir = physics->dir;
-		camera_dir.y = 0.0f;
-		vec3_norm(&camera_dir);
-
-		vec3_t camera_angles_pitch = { 0.0f, atan2f(camera_dir.z, camera_dir.x) - radiansf(90.0f), 0.0f };
-		quat_t camera_quat_pitch;
-		quat_init_angles(&camera_quat_pitch, &camera_angles_pitch);
-		quat_invert(&camera_quat_pitch, &camera_quat_pitch);
-
-		vec3_t camera_angles_yaw = { radiansf(15.0f), 0.0f, 0.0f };
-		quat_t camera_quat_yaw;
-		quat_init_angles(&camera_quat_yaw, &camera_angles_yaw);
-
-		quat_t camera_target_orient;
-		quat_mulq(&camera_quat_pitch, &camera_quat_yaw, &camera_target_orient);
-
-		vec3_t camera_final_pos;
-		quat_t camera_final_orient;
-		vec3_lerp(&camera->pos, &camera_target_pos, camera->pos_lerp, &camera_final_pos);
-		quat_slerp(&camera->quat, &camera_target_orient, camera->rot_lerp, &camera_final_orient);
-		
-		camera_set_transform(camera, &camera_final_pos, &camera_final_orient);
-		camera->pos_lerp = 0.90f;
-		camera->rot_lerp = 0.15f;
-	}
+	DIAGNOSE_CHECKPOINT(diagnose, diagnose_stage_end, physics);
 }
\ No newline at end of file
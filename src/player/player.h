@@ -1,7 +1,6 @@
 #pragma once
 
 #include "input.h"
-#include "SDL/SDL_scancode.h"
 
 typedef struct game_t game_t;
 typedef struct course_t course_t;
@@ -13,8 +12,6 @@ typedef struct player_t
 	vehicle_t*				vehicle;
 	input_t					input;
 	input_t					input_last;
-	uint8_t					last_key_state[SDL_NUM_SCANCODES];
-	bool					freecam;
 } player_t;
 
 void player_init(player_t* player);
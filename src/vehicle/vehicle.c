@@ -5,6 +5,11 @@
 
 #include "vehicle.h"
 
+#if !defined( _MSC_VER )
+extern inline bool vehicle_is_bike(vehicle_t* vehicle);
+extern inline bool vehicle_is_inside_drift(vehicle_t* vehicle);
+#endif
+
 const char* vehicle_ids[vehicle_max_id] =
 {
 	"sdf_kart", "mdf_kart", "ldf_kart", "sa_kart", "ma_kart", "la_kart", 
@@ -37,8 +42,8 @@ void vehicle_collision_add(vehicle_collision_t* collision, vehicle_t* vehicle, c
 			collision->has_trickable = true;
 
 		uint16_t kind = hit->surface & 0x1F;
-		collision->speed_factor  = fminf(collision->speed_factor, vehicle->stats.speed_multipliers[kind]);
-		collision->rot_factor	+= vehicle->stats.rotation_multipliers[kind];
+		collision->speed_factor  = fminf(collision->speed_factor, vehicle->stats->speed_multipliers[kind]);
+		collision->rot_factor	+= vehicle->stats->rotation_multipliers[kind];
 
 		if (!collision->has_trickable)
 		{
@@ -90,7 +95,7 @@ void vehicle_wheel_init(vehicle_wheel_t* wheel, bsp_wheel_t* bsp, bikepart_handl
 	vehicle_collision_init(&wheel->collision);
 }
 
-bool vehicle_wheel_update(vehicle_wheel_t* wheel, vehicle_t* vehicle, kcl_t* kcl, vec3_t* out)
+void vehicle_wheel_update_hitbox(vehicle_wheel_t* wheel, vehicle_t* vehicle)
 {
 	bsp_wheel_t* bsp_wheel = &wheel->bsp;
 	physics_t* physics = &vehicle->physics;
@@ -123,20 +128,23 @@ bool vehicle_wheel_update(vehicle_wheel_t* wheel, vehicle_t* vehicle, kcl_t* kcl
 
 	hitbox_update_pos(&wheel->hitbox, &hitbox_pos);
 	vec3_sub(&hitbox_pos, &physics->pos, &wheel->hitbox_pos_rel);
+}
+
+bool vehicle_wheel_update(vehicle_wheel_t* wheel, vehicle_t* vehicle, collision_t* collision, vec3_t* out)
+{
+	bsp_wheel_t* bsp_wheel = &wheel->bsp;
 
-	collision_t collision;
 	vec3_t movement;
-	kcl_collision_hitbox(kcl, &wheel->hitbox, &collision);
-	collision_movement(&collision, &movement);
+	collision_movement(collision, &movement);
 
 	vec3_add(&wheel->pos, &movement, &wheel->pos);
 	wheel->hitbox.radius = bsp_wheel->sphere_radius;
 	
 	vehicle_collision_init(&wheel->collision);
-	if (collision.surface_kinds & 0x20E80FFF)
+	if (collision->surface_kinds & 0x20E80FFF)
 	{
-		vehicle_collision_add(&wheel->collision, vehicle, &collision);
-		surface_props_add(&vehicle->surface_props, &collision, true);
+		vehicle_collision_add(&wheel->collision, vehicle, collision);
+		surface_props_add(&vehicle->surface_props, collision, true);
 	}
 	
 	vec3_t delta;
@@ -183,7 +191,7 @@ void vehicle_wheel_update_suspension(vehicle_wheel_t* wheel, vehicle_t* vehicle,
 			vec3_t acceleration_dir = { acceleration.x, 0.0f, acceleration.z };
 			vec3_proj_unit(&acceleration_dir, &wheel->collision.floor_normal, &temp);
 			float normal_acceleration = acceleration.y + temp.y;
-			float max_normal_acceleration = vehicle->stats.max_normal_acceleration;
+			float max_normal_acceleration = vehicle->stats->max_normal_acceleration;
 			physics->normal_acceleration += fminf(normal_acceleration, max_normal_acceleration);
 		}
 
@@ -305,7 +313,6 @@ void vehicle_wheel_dump_state(vehicle_wheel_t* wheel)
 
 void vehicle_body_init(vehicle_body_t* body, bsp_t* bsp, mat34_t* mat)
 {
-	body->hitboxes = malloc(bsp->hitbox_count * sizeof(*body->hitboxes));
 	for (int i = 0; i < bsp->hitbox_count; i++)
 	{
 		hitbox_t*     hitbox     = &body->hitboxes[i];
@@ -316,6 +323,7 @@ void vehicle_body_init(vehicle_body_t* body, bsp_t* bsp, mat34_t* mat)
 		hitbox->last_pos_valid = true;
 		hitbox->radius = bsp_hitbox->sphere_radius;
 		hitbox->flags  = 0x20E80FFF;
+		hitbox_reset_leaf(hitbox);
 	}
 
 	body->bsp_hitboxes		  = bsp->hitboxes;
@@ -326,10 +334,8 @@ void vehicle_body_init(vehicle_body_t* body, bsp_t* bsp, mat34_t* mat)
 
 void vehicle_body_free(vehicle_body_t* body)
 {
-	free(body->hitboxes);
 	body->bsp_hitboxes = NULL;
 	body->hitbox_count = 0;
-	body->hitboxes = NULL;
 }
 
 void vehicle_body_update(vehicle_body_t* body, vehicle_t* vehicle, kcl_t* kcl)
@@ -343,6 +349,11 @@ void vehicle_body_update(vehicle_body_t* body, vehicle_t* vehicle, kcl_t* kcl)
 	vehicle_collision_t* collision = &body->collision;
 	vehicle_collision_init(collision);
 
+	hitbox_t* hitboxes[bsp_max_hitboxes];
+	vec3_t hitbox_pos_rels[bsp_max_hitboxes];
+	int hitbox_indices[bsp_max_hitboxes];
+	int hitbox_count = 0;
+
 	for (int i = 0; i < body->hitbox_count; i++)
 	{
 		bsp_hitbox_t* bsp_hitbox = &body->bsp_hitboxes[i];
@@ -351,19 +362,31 @@ void vehicle_body_update(vehicle_body_t* body, vehicle_t* vehicle, kcl_t* kcl)
 		if (bsp_hitbox->wall_only)
 			continue;
 
-		vec3_t hitbox_pos_rel, pos;
-		quat_rotate(&physics->full_rot, &bsp_hitbox->sphere_center, &hitbox_pos_rel);
+		vec3_t* hitbox_pos_rel = &hitbox_pos_rels[hitbox_count];
+		vec3_t pos;
+		quat_rotate(&physics->full_rot, &bsp_hitbox->sphere_center, hitbox_pos_rel);
 
-		vec3_add(&hitbox_pos_rel, &physics->pos, &pos);
+		vec3_add(hitbox_pos_rel, &physics->pos, &pos);
 		hitbox_update_pos(hitbox, &pos);
 
-		collision_t hitbox_collision;
-		kcl_collision_hitbox(kcl, hitbox, &hitbox_collision);
+		hitboxes[hitbox_count] = hitbox;
+		hitbox_indices[hitbox_count++] = i;
+	}
+
+	/* positions only depend on physics, so every sphere is queried in one go */
+	collision_t hitbox_collisions[bsp_max_hitboxes];
+	kcl_collision_hitboxes(kcl, hitboxes, hitbox_count, hitbox_collisions);
 
-		if (hitbox_collision.surface_kinds & 0x20E80FFF)
+	for (int i = 0; i < hitbox_count; i++)
+	{
+		bsp_hitbox_t* bsp_hitbox = &body->bsp_hitboxes[hitbox_indices[i]];
+		vec3_t* hitbox_pos_rel   = &hitbox_pos_rels[i];
+		collision_t* hitbox_collision = &hitbox_collisions[i];
+
+		if (hitbox_collision->surface_kinds & 0x20E80FFF)
 		{
 			vec3_t movement, dir, sphere, temp;
-			collision_movement(&hitbox_collision, &movement);
+			collision_movement(hitbox_collision, &movement);
 			vec3_min(&min, &movement, &min);
 			vec3_max(&max, &movement, &max);
 
@@ -371,11 +394,11 @@ void vehicle_body_update(vehicle_body_t* body, vehicle_t* vehicle, kcl_t* kcl)
 			vec3_norm(&dir);
 
 			vec3_mul(&dir, bsp_hitbox->sphere_radius, &sphere);
-			vec3_add(&pos_rel, &hitbox_pos_rel, &temp);
+			vec3_add(&pos_rel, hitbox_pos_rel, &temp);
 			vec3_sub(&temp, &sphere, &pos_rel);
 
-			vehicle_collision_add(collision, vehicle, &hitbox_collision);
-			surface_props_add(&vehicle->surface_props, &hitbox_collision, false);
+			vehicle_collision_add(collision, vehicle, hitbox_collision);
+			surface_props_add(&vehicle->surface_props, hitbox_collision, false);
 		}
 	}
 
@@ -410,13 +433,10 @@ void vehicle_init(vehicle_t* vehicle, bsp_t* bsp, game_t* game, uint8_t vehicle_
 { 
 	vehicle->id = vehicle_id;
 
-	param_merge(
-		&game->kartparam.sections[vehicle_id], 
-		&game->driverparam.sections[character_id], 
-		&vehicle->stats);
+	vehicle->stats = &game->data->stats[vehicle_id * game->data->stats_characters + character_id];
 
 	if (vehicle_is_bike(vehicle))
-		vehicle->bikeparts = &game->bikeparts.sections[vehicle_id - vehicle_bike_id];
+		vehicle->bikeparts = &game->data->bikeparts.sections[vehicle_id - vehicle_bike_id];
 	else
 		vehicle->bikeparts = NULL;
 
@@ -457,7 +477,6 @@ void vehicle_init(vehicle_t* vehicle, bsp_t* bsp, game_t* game, uint8_t vehicle_
 void vehicle_free(vehicle_t* vehicle)
 {
 	vehicle_body_free(&vehicle->body);
-	free(vehicle->bsp);
 	vehicle->bikeparts		 = NULL;
 	vehicle->bsp			 = NULL;
 	vehicle->player			 = NULL;
@@ -474,26 +493,26 @@ vehicle_t* vehicle_load(player_t* player, game_t* game, uint8_t vehicle_id, uint
 	}
 
 	/* TODO load from bsp folder */
-	/* TODO should be shared between vehicles, fine for now with 1 player */
-
-	char bsp_name[_MAX_PATH];
-	sprintf(bsp_name, "%s.bsp", vehicle_name);
 
-	bin_t* bsp_data = arc_find_data(&game->common, bsp_name);
-	if (!bsp_data)
+	game_data_t* data = game->data;
+	if (vehicle_id >= data->stats_vehicles || character_id >= data->stats_characters)
 	{
-		printf("Failed to load vehicle, missing %s\n", bsp_name);
+		printf("Failed to load vehicle, bad vehicle %d or character %d\n", vehicle_id, character_id);
 		return NULL;
 	}
 
-	bsp_t* bsp = malloc(sizeof(bsp_t));
-	if (!bsp_parser.parse(bsp, bsp_data))
+	if (!data->bsp_found[vehicle_id])
 	{
-		bsp_parser.free(bsp);
+		printf("Failed to load vehicle, missing %s.bsp\n", vehicle_name);
 		return NULL;
 	}
 
-	vehicle_t* vehicle = malloc(sizeof(vehicle_t));
+	/* owned by the game arena, released with the players. the bsp is shared */
+	vehicle_t* vehicle = arena_alloc(&game->arena, sizeof(vehicle_t));
+	if (!vehicle)
+		return NULL;
+
+	bsp_t* bsp = &data->bsps[vehicle_id];
 	vehicle_init(vehicle, bsp, game, vehicle_id, character_id);
 
 	player->vehicle = vehicle;
@@ -522,7 +541,7 @@ void vehicle_place(vehicle_t* vehicle, course_t* course)
 
 	/* TODO is this the best place to set it up? */
 	const vehicle_tire_t* tire_map;
-	int32_t tire_index = vehicle->stats.num_tires;
+	int32_t tire_index = vehicle->stats->num_tires;
 	if (tire_index < ARRAY_LEN(vehicle_tire_map))
 		tire_map = &vehicle_tire_map[tire_index];
 	else
@@ -547,9 +566,28 @@ void vehicle_place(vehicle_t* vehicle, course_t* course)
 	}
 }
 
+/* octree leaf cache counters over every hitbox of the vehicle */
+void vehicle_leaf_stats(vehicle_t* vehicle, uint64_t* lookups, uint64_t* hits)
+{
+	*lookups = 0;
+	*hits = 0;
+
+	for (int i = 0; i < vehicle->body.hitbox_count; i++)
+	{
+		*lookups += vehicle->body.hitboxes[i].leaf_lookups;
+		*hits    += vehicle->body.hitboxes[i].leaf_hits;
+	}
+
+	for (int i = 0; i < vehicle->wheel_count; i++)
+	{
+		*lookups += vehicle->wheels[i].hitbox.leaf_lookups;
+		*hits    += vehicle->wheels[i].hitbox.leaf_hits;
+	}
+}
+
 const char* vehicle_name_by_id(uint8_t id)
 {
-	if (id > ARRAY_LEN(vehicle_ids))
+	if (id >= ARRAY_LEN(vehicle_ids))
 		return "";
 	return vehicle_ids[id];
 }
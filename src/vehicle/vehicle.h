@@ -71,14 +71,15 @@ typedef struct
 } vehicle_wheel_t;
 
 void vehicle_wheel_init(vehicle_wheel_t* wheel, bsp_wheel_t* bsp, bikepart_handle_t* handle, vec3_t* pos, int index);
-bool vehicle_wheel_update(vehicle_wheel_t* wheel, vehicle_t* vehicle, kcl_t* kcl, vec3_t* out);
+void vehicle_wheel_update_hitbox(vehicle_wheel_t* wheel, vehicle_t* vehicle);
+bool vehicle_wheel_update(vehicle_wheel_t* wheel, vehicle_t* vehicle, collision_t* collision, vec3_t* out);
 void vehicle_wheel_update_suspension(vehicle_wheel_t* wheel, vehicle_t* vehicle, vec3_t* movement);
 void vehicle_wheel_mat(vehicle_wheel_t* wheel, physics_t* physics, mat34_t* mat);
 void vehicle_wheel_dump_state(vehicle_wheel_t* wheel);
 
 typedef struct
 {
-	hitbox_t*				hitboxes;
+	hitbox_t				hitboxes[bsp_max_hitboxes];
 	bsp_hitbox_t*			bsp_hitboxes;
 	int						hitbox_count;
 	vehicle_collision_t		collision;
@@ -93,7 +94,7 @@ typedef struct vehicle_t
 {
 	uint8_t					id;
 
-	param_section_t			stats;
+	const param_section_t*	stats;
 	bikeparts_section_t*	bikeparts;
 	bikepart_handle_t*		handle;
 	player_t*				player;
@@ -128,15 +129,16 @@ void		vehicle_free(vehicle_t* vehicle);
 vehicle_t*	vehicle_load(player_t* player, game_t* game, uint8_t vehicle_id, uint8_t character_id);
 void        vehicle_place(vehicle_t* vehicle, course_t* course);
 const char*	vehicle_name_by_id(uint8_t id);
+void		vehicle_leaf_stats(vehicle_t* vehicle, uint64_t* lookups, uint64_t* hits);
 
 inline bool vehicle_is_bike(vehicle_t* vehicle)
 {
-	int32_t drift_type = vehicle->stats.drift_type;
+	int32_t drift_type = vehicle->stats->drift_type;
 	return drift_type == drift_bike_outside || drift_type == drift_bike_inside;
 }
 
 inline bool vehicle_is_inside_drift(vehicle_t* vehicle)
 {
-	int32_t drift_type = vehicle->stats.drift_type;
+	int32_t drift_type = vehicle->stats->drift_type;
 	return drift_type == drift_bike_inside;
 }
\ No newline at end of file